@@ -0,0 +1,217 @@
+#include "Score.h"
+#include "SUS.h"
+#include "SusParser.h"
+#include "SusExporter.h"
+#include "ScoreConverter.h"
+#include "Stopwatch.h"
+#include "IO.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace MikuMikuWorld;
+
+enum class Conversion
+{
+	ToMmws,
+	ToSus
+};
+
+struct ConversionJob
+{
+	fs::path input;
+	fs::path output;
+	uintmax_t size{};
+};
+
+struct ConversionResult
+{
+	double seconds{};
+	bool success{ false };
+	std::string error;
+};
+
+static void printUsage()
+{
+	std::printf(
+		"Usage: MMWConverter <input directory> <output directory> [--to-mmws | --to-sus] [--threads N]\n"
+		"  --to-mmws    convert every .sus file to .mmws (default)\n"
+		"  --to-sus     convert every .mmws file to .sus\n"
+		"  --threads N  number of worker threads (default: hardware concurrency)\n");
+}
+
+static std::string toUtf8(const fs::path& path)
+{
+	return path.u8string();
+}
+
+static std::vector<ConversionJob> collectJobs(const fs::path& inputDir, const fs::path& outputDir, Conversion conversion)
+{
+	std::string inputExtension = conversion == Conversion::ToMmws ? ".sus" : ".mmws";
+	std::string outputExtension = conversion == Conversion::ToMmws ? ".mmws" : ".sus";
+
+	std::vector<ConversionJob> jobs;
+	for (const auto& entry : fs::recursive_directory_iterator(inputDir))
+	{
+		if (!entry.is_regular_file())
+			continue;
+
+		std::string extension = entry.path().extension().u8string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		if (extension != inputExtension)
+			continue;
+
+		fs::path output = outputDir / fs::relative(entry.path(), inputDir);
+		output.replace_extension(outputExtension);
+		jobs.push_back({ entry.path(), output, entry.file_size() });
+	}
+
+	// largest files first so a big chart picked up last does not hold up the whole batch
+	std::stable_sort(jobs.begin(), jobs.end(),
+		[](const ConversionJob& a, const ConversionJob& b) { return a.size > b.size; });
+
+	return jobs;
+}
+
+static ConversionResult convert(const ConversionJob& job, Conversion conversion, bool parallelDecoding)
+{
+	ConversionResult result;
+	Stopwatch stopwatch;
+	stopwatch.reset();
+
+	try
+	{
+		std::error_code error;
+		fs::create_directories(job.output.parent_path(), error);
+
+		if (conversion == Conversion::ToMmws)
+		{
+			resetNextID();
+			SusParser parser;
+			parser.setParallelDecoding(parallelDecoding);
+			Score score = ScoreConverter::susToScore(parser.parse(toUtf8(job.input)));
+			serializeScore(score, toUtf8(job.output));
+		}
+		else
+		{
+			Score score = deserializeScore(toUtf8(job.input));
+			SusExporter exporter;
+			exporter.dump(ScoreConverter::scoreToSus(score), toUtf8(job.output), "This file was generated by MikuMikuWorld");
+		}
+
+		result.success = true;
+	}
+	catch (std::exception& ex)
+	{
+		result.error = ex.what();
+	}
+
+	result.seconds = stopwatch.elapsed();
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> positional;
+	Conversion conversion = Conversion::ToMmws;
+	int threadCount = std::thread::hardware_concurrency();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--to-mmws")
+			conversion = Conversion::ToMmws;
+		else if (arg == "--to-sus")
+			conversion = Conversion::ToSus;
+		else if (arg == "--threads" && i + 1 < argc)
+			threadCount = std::atoi(argv[++i]);
+		else if (arg == "--help" || arg == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else
+			positional.push_back(arg);
+	}
+
+	if (positional.size() != 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	fs::path inputDir = fs::u8path(positional[0]);
+	fs::path outputDir = fs::u8path(positional[1]);
+	if (!fs::is_directory(inputDir))
+	{
+		std::fprintf(stderr, "Input directory not found: %s\n", positional[0].c_str());
+		return 1;
+	}
+
+	std::vector<ConversionJob> jobs;
+	try
+	{
+		jobs = collectJobs(inputDir, outputDir, conversion);
+	}
+	catch (std::exception& ex)
+	{
+		std::fprintf(stderr, "Failed to list the input directory: %s\n", ex.what());
+		return 1;
+	}
+
+	threadCount = std::clamp(threadCount, 1, std::max((int)jobs.size(), 1));
+	std::printf("Converting %zu files on %d threads\n", jobs.size(), threadCount);
+
+	Stopwatch total;
+	total.reset();
+
+	std::atomic<size_t> nextJob{ 0 };
+	std::atomic<int> failures{ 0 };
+	std::mutex outputMutex;
+
+	// files are already spread over the threads, so a parse splitting its own work only adds contention
+	const bool parallelDecoding = threadCount == 1;
+	auto worker = [&]()
+	{
+		for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+		{
+			ConversionResult result = convert(jobs[i], conversion, parallelDecoding);
+			if (!result.success)
+				++failures;
+
+			std::string input = toUtf8(fs::relative(jobs[i].input, inputDir));
+			std::lock_guard<std::mutex> lock{ outputMutex };
+			if (result.success)
+				std::printf("%8.2f ms  %s\n", result.seconds * 1000.0, input.c_str());
+			else
+				std::printf("%8.2f ms  %s  FAILED: %s\n", result.seconds * 1000.0, input.c_str(), result.error.c_str());
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threadCount; ++i)
+		workers.emplace_back(worker);
+
+	worker();
+	for (auto& thread : workers)
+		thread.join();
+
+	double elapsed = total.elapsed();
+	uintmax_t totalSize = 0;
+	for (const auto& job : jobs)
+		totalSize += job.size;
+
+	double safeElapsed = std::max(elapsed, 1e-9);
+	std::printf("\n%zu files, %d failed in %.3f s (%.1f files/s, %.2f MB/s)\n",
+		jobs.size(), failures.load(), elapsed, jobs.size() / safeElapsed, totalSize / (1024.0 * 1024.0) / safeElapsed);
+
+	return failures ? 2 : 0;
+}
@@ -49,6 +49,7 @@ namespace MikuMikuWorld
 
 		editor = std::make_unique<ScoreEditor>();
 		editor->loadPresets(appDir + "library");
+		editor->offerRecovery();
 
 		initialized = true;
 		return Result::Ok();;
@@ -283,24 +284,28 @@ namespace MikuMikuWorld
 	void Application::loadResources()
 	{
 		ResourceManager::loadShader(appDir + "res/shaders/basic2d");
-		ResourceManager::loadTexture(appDir + "res/textures/tex_notes.png");
-		ResourceManager::loadTexture(appDir + "res/textures/tex_hold_path.png");
-		ResourceManager::loadTexture(appDir + "res/textures/tex_hold_path_crtcl.png");
-		ResourceManager::loadTexture(appDir + "res/textures/default.png");
-
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_select.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_tap.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_hold.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_hold_step_normal.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_hold_step_hidden.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_hold_step_skip.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_flick_default.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_flick_left.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_flick_right.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_critical.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_bpm.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_time_signature.png");
-		ResourceManager::loadTexture(appDir + "res/textures/timeline_hi_speed.png");
+		// notes, hold paths and toolbar icons are packed together to avoid texture switches while drawing
+		std::string texturesDir = appDir + "res/textures/";
+		ResourceManager::loadTextureAtlas("timeline_atlas", {
+			texturesDir + "tex_notes.png",
+			texturesDir + "tex_hold_path.png",
+			texturesDir + "tex_hold_path_crtcl.png",
+			texturesDir + "timeline_select.png",
+			texturesDir + "timeline_tap.png",
+			texturesDir + "timeline_hold.png",
+			texturesDir + "timeline_hold_step_normal.png",
+			texturesDir + "timeline_hold_step_hidden.png",
+			texturesDir + "timeline_hold_step_skip.png",
+			texturesDir + "timeline_flick_default.png",
+			texturesDir + "timeline_flick_left.png",
+			texturesDir + "timeline_flick_right.png",
+			texturesDir + "timeline_critical.png",
+			texturesDir + "timeline_bpm.png",
+			texturesDir + "timeline_time_signature.png",
+			texturesDir + "timeline_hi_speed.png"
+		});
+
+		ResourceManager::loadTexture(texturesDir + "default.png");
 
 		// cache note textures indices
 		noteTextures.notes = ResourceManager::getTexture(NOTES_TEX);
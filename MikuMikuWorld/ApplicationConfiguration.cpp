@@ -76,6 +76,7 @@ namespace MikuMikuWorld
 			autoSaveEnabled	= jsonIO::tryGetValue<bool>(config["save"], "auto_save_enabled", true);
 			autoSaveInterval = jsonIO::tryGetValue<int>(config["save"], "auto_save_interval", 5);
 			autoSaveMaxCount = jsonIO::tryGetValue<int>(config["save"], "auto_save_max_count", 100);
+			editJournalEnabled = jsonIO::tryGetValue<bool>(config["save"], "edit_journal_enabled", false);
 		}
 
 		if (jsonIO::keyExists(config, "audio"))
@@ -153,7 +154,8 @@ namespace MikuMikuWorld
 		config["save"] = {
 			{"auto_save_enabled", autoSaveEnabled},
 			{"auto_save_interval", autoSaveInterval},
-			{"auto_save_max_count", autoSaveMaxCount}
+			{"auto_save_max_count", autoSaveMaxCount},
+			{"edit_journal_enabled", editJournalEnabled}
 		};
 
 		config["audio"] = {
@@ -211,6 +213,7 @@ namespace MikuMikuWorld
 		autoSaveEnabled = true;
 		autoSaveInterval = 5;
 		autoSaveMaxCount = 100;
+		editJournalEnabled = false;
 
 		masterVolume = 0.8f;
 		bgmVolume = 1.0f;
@@ -76,6 +76,7 @@ namespace MikuMikuWorld
 		bool autoSaveEnabled;
 		int autoSaveInterval;
 		int autoSaveMaxCount;
+		bool editJournalEnabled;
 		float masterVolume;
 		float bgmVolume;
 		float seVolume;
@@ -0,0 +1,152 @@
+#include "AutoSave.h"
+#include "ApplicationConfiguration.h"
+#include "Constants.h"
+#include "IO.h"
+#include <filesystem>
+#include <algorithm>
+#include <ctime>
+
+namespace MikuMikuWorld
+{
+	constexpr const char* autoSavePrefix = "mmw_auto_save_";
+
+	std::string AutoSave::getLockFilename() const
+	{
+		return directory + "/session.lock";
+	}
+
+	void AutoSave::start(const std::string& path)
+	{
+		directory = path;
+		std::wstring wDirectory = IO::mbToWideStr(directory);
+		std::error_code error;
+		std::filesystem::create_directories(wDirectory, error);
+
+		// the lock file is removed on a proper exit so finding it means the last session crashed
+		std::wstring wLockFilename = IO::mbToWideStr(getLockFilename());
+		if (std::filesystem::exists(wLockFilename))
+		{
+			std::wstring latest;
+			for (const auto& file : std::filesystem::directory_iterator(wDirectory))
+			{
+				std::wstring wFilename = file.path().filename().wstring();
+				if (file.path().extension().wstring() == L".mmws" && wFilename > latest)
+					latest = wFilename;
+			}
+
+			if (latest.size())
+				recoveryFile = IO::wideStringToMb((std::filesystem::path(wDirectory) / latest).wstring());
+		}
+
+		FILE* lock = IO::openFile(getLockFilename(), "wb");
+		if (lock)
+			fclose(lock);
+
+		lastSaveTime = std::chrono::steady_clock::now();
+		stopping = false;
+		worker = std::thread(&AutoSave::run, this);
+	}
+
+	void AutoSave::stop()
+	{
+		if (!worker.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+
+		condition.notify_one();
+		worker.join();
+
+		std::error_code error;
+		std::filesystem::remove(IO::mbToWideStr(getLockFilename()), error);
+	}
+
+	void AutoSave::update(const ScoreContext& context)
+	{
+		if (!config.autoSaveEnabled || context.upToDate || context.history.getVersion() == lastSaveVersion)
+			return;
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - lastSaveTime < std::chrono::minutes(std::max(config.autoSaveInterval, 1)))
+			return;
+
+		lastSaveTime = now;
+		lastSaveVersion = context.history.getVersion();
+
+		// copying the score shares its note storage so this does not stall the frame
+		Score snapshot = context.score;
+		snapshot.metadata = context.getWorkingMetadata();
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			pending = std::move(snapshot);
+			maxFiles = std::max(config.autoSaveMaxCount, 1);
+		}
+
+		condition.notify_one();
+	}
+
+	void AutoSave::run()
+	{
+		while (true)
+		{
+			std::optional<Score> score;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				condition.wait(lock, [this] { return stopping || pending.has_value(); });
+
+				if (!pending)
+					return;
+
+				score = std::move(pending);
+				pending.reset();
+			}
+
+			write(*score);
+		}
+	}
+
+	void AutoSave::write(const Score& score)
+	{
+		std::time_t now = std::time(nullptr);
+		char timestamp[32]{};
+		std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d_%H-%M-%S", std::localtime(&now));
+
+		try
+		{
+			serializeScore(score, directory + "/" + autoSavePrefix + timestamp + MMWS_EXTENSION);
+			removeOldFiles();
+		}
+		catch (std::exception&)
+		{
+			// a failed autosave is retried at the next interval
+		}
+	}
+
+	void AutoSave::removeOldFiles()
+	{
+		std::vector<std::filesystem::path> files;
+		for (const auto& file : std::filesystem::directory_iterator(IO::mbToWideStr(directory)))
+		{
+			if (file.path().extension().wstring() == L".mmws")
+				files.push_back(file.path());
+		}
+
+		// timestamps in the names sort the files from oldest to newest
+		std::sort(files.begin(), files.end());
+
+		size_t maxCount;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			maxCount = maxFiles;
+		}
+
+		for (size_t i = 0; i + maxCount < files.size(); ++i)
+		{
+			std::error_code error;
+			std::filesystem::remove(files[i], error);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "ScoreContext.h"
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <chrono>
+
+namespace MikuMikuWorld
+{
+	class AutoSave
+	{
+	private:
+		std::string directory;
+		std::string recoveryFile;
+
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::optional<Score> pending;
+		int maxFiles{ 1 };
+		bool stopping{ false };
+
+		std::chrono::steady_clock::time_point lastSaveTime;
+		int lastSaveVersion{ -1 };
+
+		void run();
+		void write(const Score& score);
+		void removeOldFiles();
+		std::string getLockFilename() const;
+
+	public:
+		/// <summary>
+		/// Starts the autosave worker writing into the specified directory
+		/// </summary>
+		/// <param name="path">The directory to write autosaves to</param>
+		void start(const std::string& path);
+
+		/// <summary>
+		/// Waits for the save in progress, if any, and marks the session as closed properly
+		/// </summary>
+		void stop();
+
+		/// <summary>
+		/// Queues a snapshot of the score to be written on the worker thread
+		/// if it has unsaved changes and the autosave interval has passed
+		/// </summary>
+		/// <param name="context">The context of the score to save</param>
+		void update(const ScoreContext& context);
+
+		/// <summary>
+		/// The latest autosave of a session that did not close properly or an empty string
+		/// </summary>
+		inline const std::string& getRecoveryFile() const { return recoveryFile; }
+	};
+}
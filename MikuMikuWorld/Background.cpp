@@ -74,6 +74,7 @@ namespace MikuMikuWorld
 		Shader* blur = ResourceManager::shaders[s];
 		blur->use();
 		blur->setMatrix4("projection", DirectX::XMMatrixOrthographicRH(w, -h, 0.001f, 100));
+		blur->setMatrix4("view", DirectX::XMMatrixIdentity());
 
 		framebuffer->bind();
 		framebuffer->clear();
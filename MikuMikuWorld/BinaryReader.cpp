@@ -1,80 +1,112 @@
 #include "BinaryReader.h"
 #include "IO.h"
+#include <cstring>
 
 namespace IO
 {
-	BinaryReader::BinaryReader(const std::string& filename)
+	BinaryReader::BinaryReader(const std::string& filename, size_t maxSize)
+		: position{ 0 }, valid{ false }
+	{
+		FILE* stream = openFile(filename, "rb");
+		if (!stream)
+			return;
+
+		fseek(stream, 0, SEEK_END);
+		long size = ftell(stream);
+		fseek(stream, 0, SEEK_SET);
+
+		if (size > 0 && (size_t)size > maxSize)
+			size = maxSize;
+
+		if (size > 0)
+		{
+			buffer.resize(size);
+			valid = fread(buffer.data(), 1, size, stream) == size;
+		}
+		else
+		{
+			valid = size == 0;
+		}
+
+		fclose(stream);
+	}
+
+	BinaryReader::BinaryReader(std::vector<uint8_t> data)
+		: buffer{ std::move(data) }, position{ 0 }, valid{ true }
 	{
-		stream = NULL;
-		std::wstring wFilename = mbToWideStr(filename);
-		stream = _wfopen(wFilename.c_str(), L"rb");
+	}
+
+	void BinaryReader::require(size_t count) const
+	{
+		if (!valid || count > buffer.size() - position)
+			throw std::runtime_error("Unexpected end of file at offset " + std::to_string(position) + ".");
 	}
 
 	bool BinaryReader::isStreamValid()
 	{
-		return stream;
+		return valid;
 	}
 
 	void BinaryReader::close()
 	{
-		if (stream)
-			fclose(stream);
+		buffer.clear();
+		buffer.shrink_to_fit();
+		position = 0;
+		valid = false;
 	}
 
 	size_t BinaryReader::getFileSize()
 	{
-		size_t pos = ftell(stream);
-		fseek(stream, 0, SEEK_END);
-
-		size_t size = ftell(stream);
-		fseek(stream, pos, SEEK_SET);
-
-		return size;
+		return buffer.size();
 	}
 
 	size_t BinaryReader::getStreamPosition()
 	{
-		return ftell(stream);
+		return position;
 	}
 
 	uint32_t BinaryReader::readInt32()
 	{
-		uint32_t data = 0;
-		if (stream)
-			fread(&data, sizeof(uint32_t), 1, stream);
+		require(sizeof(uint32_t));
+
+		uint32_t data;
+		memcpy(&data, buffer.data() + position, sizeof(uint32_t));
+		position += sizeof(uint32_t);
 
 		return data;
 	}
 
 	float BinaryReader::readSingle()
 	{
-		float data = 0;
-		if (stream)
-			fread(&data, sizeof(float), 1, stream);
+		require(sizeof(float));
+
+		float data;
+		memcpy(&data, buffer.data() + position, sizeof(float));
+		position += sizeof(float);
 
 		return data;
 	}
 
 	std::string BinaryReader::readString()
 	{
-		char c = 'a';
-		std::string data = "";
-		if (stream)
-		{
-			while (c && !feof(stream))
-			{
-				fread(&c, sizeof(uint8_t), 1, stream);
-				if (c)
-					data += c;
-			}
+		require(1);
+
+		const char* begin = reinterpret_cast<const char*>(buffer.data() + position);
+		const char* terminator = static_cast<const char*>(memchr(begin, 0, buffer.size() - position));
+		if (!terminator)
+			throw std::runtime_error("Unterminated string at offset " + std::to_string(position) + ".");
+
+		std::string data(begin, terminator);
+		position += data.size() + 1;
 
-		}
 		return data;
 	}
 
 	void BinaryReader::seek(size_t pos)
 	{
-		if (stream)
-			fseek(stream, pos, SEEK_SET);
+		if (!valid || pos > buffer.size())
+			throw std::runtime_error("Invalid file offset " + std::to_string(pos) + ".");
+
+		position = pos;
 	}
 }
\ No newline at end of file
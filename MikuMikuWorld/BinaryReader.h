@@ -1,21 +1,32 @@
 #pragma once
 #include <stdio.h>
 #include <string>
+#include <vector>
+#include <cstdint>
 
 namespace IO
 {
+	// reads the whole file into memory once and decodes from the buffer.
+	// reading or seeking past the end throws std::runtime_error
 	class BinaryReader
 	{
 	private:
-		FILE* stream;
+		std::vector<uint8_t> buffer;
+		size_t position;
+		bool valid;
+
+		void require(size_t count) const;
 
 	public:
-		BinaryReader(const std::string& filename);
+		// only the first maxSize bytes of the file are read
+		BinaryReader(const std::string& filename, size_t maxSize = SIZE_MAX);
+		BinaryReader(std::vector<uint8_t> data);
 
 		bool isStreamValid();
 		void close();
 
 		size_t getFileSize();
+		inline const std::vector<uint8_t>& getData() const { return buffer; }
 		size_t getStreamPosition();
 		void seek(size_t pos);
 
@@ -1,87 +1,89 @@
 #include "BinaryWriter.h"
 #include "IO.h"
+#include <cstring>
 
 namespace IO
 {
-	BinaryWriter::BinaryWriter(const std::string& filename)
+	BinaryWriter::BinaryWriter(const std::string& _filename)
+		: filename{ _filename }, position{ 0 }
 	{
-		stream = NULL;
-		std::wstring wFilename = mbToWideStr(filename);
-		stream = _wfopen(wFilename.c_str(), L"wb");
-	}
-
-	bool BinaryWriter::isStreamValid()
-	{
-		return stream;
 	}
 
 	void BinaryWriter::close()
 	{
-		if (stream)
-			fclose(stream);
+		buffer.clear();
+		buffer.shrink_to_fit();
+		position = 0;
 	}
 
-	void BinaryWriter::flush()
+	bool BinaryWriter::flush()
 	{
-		if (stream)
-			fflush(stream);
+		std::string tempFilename = filename + ".tmp";
+		FILE* stream = openFile(tempFilename, "wb");
+		if (!stream)
+			return false;
+
+		bool written = fwrite(buffer.data(), 1, buffer.size(), stream) == buffer.size();
+		written &= syncFile(stream);
+		written &= fclose(stream) == 0;
+
+		if (!written || !replaceFile(tempFilename, filename))
+		{
+			removeFile(tempFilename);
+			return false;
+		}
+
+		return true;
 	}
 
 	size_t BinaryWriter::getFileSize()
 	{
-		size_t pos = ftell(stream);
-		fseek(stream, 0, SEEK_END);
-
-		size_t size = ftell(stream);
-		fseek(stream, pos, SEEK_SET);
-
-		return size;
+		return buffer.size();
 	}
 
 	size_t BinaryWriter::getStreamPosition()
 	{
-		return ftell(stream);
+		return position;
 	}
 
 	void BinaryWriter::seek(size_t pos)
 	{
-		if (stream)
-			fseek(stream, pos, SEEK_SET);
+		if (pos > buffer.size())
+			buffer.resize(pos);
+
+		position = pos;
+	}
+
+	void BinaryWriter::write(const void* data, size_t size)
+	{
+		if (position + size > buffer.size())
+			buffer.resize(position + size);
+
+		memcpy(buffer.data() + position, data, size);
+		position += size;
 	}
 
 	void BinaryWriter::writeInt32(uint32_t data)
 	{
-		if (stream)
-			fwrite(&data, sizeof(uint32_t), 1, stream);
+		write(&data, sizeof(uint32_t));
 	}
 
 	void BinaryWriter::writeSingle(float data)
 	{
-		if (stream)
-			fwrite(&data, sizeof(float), 1, stream);
+		write(&data, sizeof(float));
 	}
 
 	void BinaryWriter::writeNull(size_t length)
 	{
-		uint8_t zero = 0;
-		if (stream)
-			fwrite(&zero, sizeof(uint8_t), length, stream);
+		if (position + length > buffer.size())
+			buffer.resize(position + length);
+
+		memset(buffer.data() + position, 0, length);
+		position += length;
 	}
 
 	void BinaryWriter::writeString(std::string data)
 	{
-		if (stream)
-		{
-			size_t length = data.size();
-			if (length)
-			{
-				fwrite(data.c_str(), sizeof(char), length, stream);
-				writeNull(1);
-			}
-			else
-			{
-				writeNull(1);
-			}
-		}
+		write(data.c_str(), data.size() + 1);
 	}
 }
\ No newline at end of file
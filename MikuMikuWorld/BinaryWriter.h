@@ -1,22 +1,30 @@
 #pragma once
 #include <stdio.h>
 #include <string>
+#include <vector>
 
 namespace IO
 {
+	// builds the file in memory and writes it out in one go on flush.
+	// the data goes to a temporary file which then replaces the destination,
+	// so an interrupted save leaves the previous file intact
 	class BinaryWriter
 	{
 	private:
-		FILE* stream;
+		std::string filename;
+		std::vector<uint8_t> buffer;
+		size_t position;
+
+		void write(const void* data, size_t size);
 
 	public:
 		BinaryWriter(const std::string& filename);
 
-		bool isStreamValid();
 		void close();
-		void flush();
+		bool flush();
 
 		size_t getFileSize();
+		inline const std::vector<uint8_t>& getData() const { return buffer; }
 		size_t getStreamPosition();
 
 		void seek(size_t pos);
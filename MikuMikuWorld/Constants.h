@@ -63,4 +63,7 @@ namespace MikuMikuWorld
 
 	constexpr const char* SUS_EXTENSION			= ".sus";
 	constexpr const char* MMWS_EXTENSION		= ".mmws";
+	constexpr const char* MMWJ_EXTENSION		= ".mmwj";
+
+	constexpr int MMWS_VERSION = 4;
 }
\ No newline at end of file
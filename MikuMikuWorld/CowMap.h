@@ -0,0 +1,148 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+
+namespace MikuMikuWorld
+{
+	// whether no other copy shares the data, so it can be written in place.
+	// use_count is a relaxed read, and the last copy may have just been released on another thread,
+	// so the fence keeps the writes from being reordered before that release
+	template <typename T>
+	inline bool isExclusive(const std::shared_ptr<T>& data)
+	{
+		if (data.use_count() > 1)
+			return false;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return true;
+	}
+
+	// unordered_map split into shards that are shared between copies.
+	// copying only copies the shard pointers and the first write to a shard
+	// after a copy duplicates that shard alone.
+	// references returned by non-const accessors are invalidated when the map is copied
+	template <typename Key, typename Value, int ShardCount = 64>
+	class CowMap
+	{
+	private:
+		using Shard = std::unordered_map<Key, Value>;
+
+		std::array<std::shared_ptr<Shard>, ShardCount> shards;
+		size_t count{ 0 };
+
+		inline static int shardOf(const Key& key) { return std::hash<Key>{}(key) % ShardCount; }
+
+		Shard& writableShard(const Key& key)
+		{
+			std::shared_ptr<Shard>& shard = shards[shardOf(key)];
+			if (!isExclusive(shard))
+				shard = std::make_shared<Shard>(*shard);
+
+			return *shard;
+		}
+
+	public:
+		class const_iterator
+		{
+		private:
+			const CowMap* map;
+			int shard;
+			typename Shard::const_iterator it;
+
+			void skipEmpty()
+			{
+				while (shard < ShardCount && it == map->shards[shard]->end())
+				{
+					if (++shard < ShardCount)
+						it = map->shards[shard]->begin();
+				}
+			}
+
+		public:
+			const_iterator(const CowMap* _map, int _shard, typename Shard::const_iterator _it)
+				: map{ _map }, shard{ _shard }, it{ _it }
+			{
+				skipEmpty();
+			}
+
+			inline const typename Shard::value_type& operator*() const { return *it; }
+			inline const typename Shard::value_type* operator->() const { return &*it; }
+
+			const_iterator& operator++()
+			{
+				++it;
+				skipEmpty();
+				return *this;
+			}
+
+			inline bool operator==(const const_iterator& other) const { return shard == other.shard && (shard == ShardCount || it == other.it); }
+			inline bool operator!=(const const_iterator& other) const { return !(*this == other); }
+		};
+
+		CowMap()
+		{
+			for (auto& shard : shards)
+				shard = std::make_shared<Shard>();
+		}
+
+		inline size_t size() const { return count; }
+		inline bool empty() const { return count == 0; }
+
+		void reserve(size_t total)
+		{
+			for (auto& shard : shards)
+			{
+				if (!isExclusive(shard))
+					shard = std::make_shared<Shard>(*shard);
+
+				shard->reserve(total / ShardCount + 1);
+			}
+		}
+
+		void clear()
+		{
+			for (auto& shard : shards)
+				shard = std::make_shared<Shard>();
+
+			count = 0;
+		}
+
+		const_iterator begin() const { return const_iterator(this, 0, shards[0]->begin()); }
+		const_iterator end() const { return const_iterator(this, ShardCount, {}); }
+
+		const_iterator find(const Key& key) const
+		{
+			const int shard = shardOf(key);
+			auto it = shards[shard]->find(key);
+			return it != shards[shard]->end() ? const_iterator(this, shard, it) : end();
+		}
+
+		inline bool contains(const Key& key) const { return shards[shardOf(key)]->count(key) != 0; }
+
+		inline const Value& at(const Key& key) const { return shards[shardOf(key)]->at(key); }
+		inline Value& at(const Key& key) { return writableShard(key).at(key); }
+
+		Value& operator[](const Key& key)
+		{
+			Shard& shard = writableShard(key);
+			auto [it, inserted] = shard.try_emplace(key);
+			count += inserted;
+
+			return it->second;
+		}
+
+		size_t erase(const Key& key)
+		{
+			if (!contains(key))
+				return 0;
+
+			writableShard(key).erase(key);
+			--count;
+
+			return 1;
+		}
+	};
+}
@@ -42,6 +42,7 @@ namespace MikuMikuWorld
 		{"auto_save_enable", "Auto Save Enabled"},
 		{"auto_save_interval", "Auto Save Interval (min)"},
 		{"auto_save_count", "Maximum Auto Save Entries"},
+		{"edit_journal_enable", "Save Edits to Journal"},
 		{"theme", "Theme"},
 		{"base_theme", "Base Theme"},
 		{"theme_light", "Light"},
@@ -0,0 +1,597 @@
+#include "EditJournal.h"
+#include "BinaryReader.h"
+#include "BinaryWriter.h"
+#include "Constants.h"
+#include "IO.h"
+#include <filesystem>
+#include <cstring>
+
+namespace MikuMikuWorld
+{
+	constexpr const char* journalSignature = "MMWJ";
+	constexpr int journalVersion = 1;
+
+	// type and payload length
+	constexpr size_t recordHeaderSize = sizeof(uint32_t) * 2;
+
+	enum EventsMask : uint32_t
+	{
+		EventsMaskTempo = 1 << 0,
+		EventsMaskTimeSignature = 1 << 1,
+		EventsMaskHiSpeed = 1 << 2
+	};
+
+	static bool sameMetadata(const ScoreMetadata& a, const ScoreMetadata& b)
+	{
+		return a.title == b.title && a.author == b.author && a.artist == b.artist &&
+			a.musicFile == b.musicFile && a.jacketFile == b.jacketFile && a.musicOffset == b.musicOffset;
+	}
+
+	EditJournal::~EditJournal()
+	{
+		if (stream)
+			fclose(stream);
+	}
+
+	std::string EditJournal::getJournalFilename(const std::string& scoreFilename)
+	{
+		size_t dot = scoreFilename.find_last_of('.');
+		size_t separator = scoreFilename.find_last_of("\\/");
+		if (dot == std::string::npos || (separator != std::string::npos && dot < separator))
+			return scoreFilename + MMWJ_EXTENSION;
+
+		return scoreFilename.substr(0, dot) + MMWJ_EXTENSION;
+	}
+
+	void EditJournal::mapBaseNotes(const MmwsLayout& layout)
+	{
+		journalIDs.clear();
+		sessionIDs.clear();
+		for (int i = 0; i < layout.noteIDs.size(); ++i)
+		{
+			journalIDs[layout.noteIDs[i]] = i;
+			sessionIDs[i] = layout.noteIDs[i];
+		}
+
+		nextJournalID = layout.noteIDs.size();
+		baseNoteCount = layout.noteIDs.size();
+		baseChecksum = layout.checksum;
+		baseSize = layout.fileSize;
+	}
+
+	int EditJournal::toJournalID(int id)
+	{
+		if (id == -1)
+			return -1;
+
+		auto it = journalIDs.find(id);
+		if (it != journalIDs.end())
+			return it->second;
+
+		int journalID = nextJournalID++;
+		journalIDs[id] = journalID;
+		sessionIDs[journalID] = id;
+
+		return journalID;
+	}
+
+	int EditJournal::toSessionID(int id)
+	{
+		if (id == -1)
+			return -1;
+
+		auto it = sessionIDs.find(id);
+		if (it != sessionIDs.end())
+			return it->second;
+
+		int sessionID = nextID++;
+		sessionIDs[id] = sessionID;
+		journalIDs[sessionID] = id;
+		nextJournalID = std::max(nextJournalID, id + 1);
+
+		return sessionID;
+	}
+
+	void EditJournal::load(const std::string& scoreFilename, const MmwsLayout& layout, Score& score)
+	{
+		close();
+		journalFilename = getJournalFilename(scoreFilename);
+		mapBaseNotes(layout);
+
+		size = committedSize = diskSize = loadedEnd = 0;
+		loadedData.clear();
+		committedMetadata = score.metadata;
+
+		IO::BinaryReader reader(journalFilename);
+		if (!reader.isStreamValid() || !reader.getFileSize())
+			return;
+
+		diskSize = reader.getFileSize();
+		try
+		{
+			// a journal written against another version of the file does not apply to it
+			if (reader.readString() != journalSignature || reader.readInt32() != journalVersion ||
+				reader.readInt32() != baseChecksum || reader.readInt32() != baseNoteCount)
+				return;
+		}
+		catch (std::runtime_error&)
+		{
+			return;
+		}
+
+		loadedData = reader.getData();
+		size_t begin = reader.getStreamPosition();
+		size_t lastCommit = scanRecords(begin);
+
+		// the copy shares the score's storage so a bad record leaves the score untouched
+		Score replayed = score;
+		try
+		{
+			applyRecords(replayed, begin, lastCommit);
+		}
+		catch (std::runtime_error&)
+		{
+			// an unreadable journal is treated like a stale one and replaced on the next edit
+			mapBaseNotes(layout);
+			loadedData.clear();
+			loadedEnd = 0;
+			return;
+		}
+
+		score = std::move(replayed);
+		size = committedSize = lastCommit;
+		committedMetadata = score.metadata;
+	}
+
+	void EditJournal::reset(const std::string& scoreFilename, const MmwsLayout& layout, const ScoreMetadata& metadata, bool _active)
+	{
+		std::string filename = getJournalFilename(scoreFilename);
+		if (filename != journalFilename)
+			close();
+
+		if (stream)
+			fclose(stream);
+
+		stream = nullptr;
+		journalFilename = filename;
+		mapBaseNotes(layout);
+
+		// the file now holds every edit so the old journal is dropped
+		std::error_code error;
+		std::filesystem::remove(IO::mbToWideStr(journalFilename), error);
+
+		size = committedSize = diskSize = loadedEnd = 0;
+		loadedData.clear();
+		committedMetadata = metadata;
+		setActive(_active);
+	}
+
+	void EditJournal::close()
+	{
+		if (stream)
+			fclose(stream);
+
+		stream = nullptr;
+		if (journalFilename.size() && diskSize > committedSize)
+			truncate(committedSize);
+
+		active = false;
+		journalFilename.clear();
+		journalIDs.clear();
+		sessionIDs.clear();
+		loadedData.clear();
+		size = committedSize = diskSize = loadedEnd = 0;
+	}
+
+	bool EditJournal::hasUncommittedEdits() const
+	{
+		return loadedEnd > committedSize;
+	}
+
+	void EditJournal::replayUncommitted(Score& score)
+	{
+		if (!hasUncommittedEdits())
+			return;
+
+		applyRecords(score, committedSize, loadedEnd);
+		size = loadedEnd;
+		loadedData.clear();
+		loadedEnd = 0;
+	}
+
+	void EditJournal::discardUncommitted()
+	{
+		if (!hasUncommittedEdits())
+			return;
+
+		truncate(committedSize);
+		size = committedSize;
+		loadedData.clear();
+		loadedEnd = 0;
+	}
+
+	bool EditJournal::canCommit(const std::string& scoreFilename) const
+	{
+		// rewrite the file once replaying the journal would cost more than reading it
+		return active && getJournalFilename(scoreFilename) == journalFilename && size <= baseSize;
+	}
+
+	size_t EditJournal::scanRecords(size_t begin)
+	{
+		size_t lastCommit = begin;
+		size_t position = begin;
+		while (loadedData.size() - position >= recordHeaderSize)
+		{
+			uint32_t type, length;
+			memcpy(&type, loadedData.data() + position, sizeof(uint32_t));
+			memcpy(&length, loadedData.data() + position + sizeof(uint32_t), sizeof(uint32_t));
+
+			// a record cut short by a crash ends the journal
+			if (length > loadedData.size() - position - recordHeaderSize)
+				break;
+
+			position += recordHeaderSize + length;
+			if (type == (uint32_t)RecordType::Commit)
+				lastCommit = position;
+		}
+
+		loadedEnd = position;
+		return lastCommit;
+	}
+
+	void EditJournal::applyRecords(Score& score, size_t begin, size_t end)
+	{
+		IO::BinaryReader reader(std::vector<uint8_t>(loadedData.begin(), loadedData.begin() + end));
+		reader.seek(begin);
+
+		while (reader.getStreamPosition() < end)
+		{
+			RecordType type = (RecordType)reader.readInt32();
+			size_t length = reader.readInt32();
+			size_t recordEnd = reader.getStreamPosition() + length;
+
+			if (type == RecordType::Edit)
+			{
+				int noteCount = reader.readInt32();
+				for (int i = 0; i < noteCount; ++i)
+				{
+					int id = toSessionID(reader.readInt32());
+					if (reader.readInt32())
+					{
+						Note note = readNote(reader);
+						note.ID = id;
+						score.notes.insert(note);
+					}
+					else
+					{
+						score.notes.erase(id);
+					}
+				}
+
+				int holdCount = reader.readInt32();
+				for (int i = 0; i < holdCount; ++i)
+				{
+					int id = toSessionID(reader.readInt32());
+					if (reader.readInt32())
+					{
+						HoldNote hold = readHold(reader);
+						hold.start.ID = id;
+						score.holdNotes[id] = hold;
+					}
+					else
+						score.holdNotes.erase(id);
+				}
+
+				uint32_t events = reader.readInt32();
+				if (events & EventsMaskTempo)
+				{
+					score.tempoChanges.clear();
+					int count = reader.readInt32();
+					for (int i = 0; i < count; ++i)
+					{
+						int tick = reader.readInt32();
+						float bpm = reader.readSingle();
+						score.tempoChanges.push_back({ tick, bpm });
+					}
+				}
+
+				if (events & EventsMaskTimeSignature)
+				{
+					score.timeSignatures.clear();
+					int count = reader.readInt32();
+					for (int i = 0; i < count; ++i)
+					{
+						int measure = reader.readInt32();
+						int numerator = reader.readInt32();
+						int denominator = reader.readInt32();
+						score.timeSignatures[measure] = { measure, numerator, denominator };
+					}
+				}
+
+				if (events & EventsMaskHiSpeed)
+				{
+					score.hiSpeedChanges.clear();
+					int count = reader.readInt32();
+					for (int i = 0; i < count; ++i)
+					{
+						int tick = reader.readInt32();
+						float speed = reader.readSingle();
+						score.hiSpeedChanges.push_back({ tick, speed });
+					}
+				}
+			}
+			else if (type == RecordType::Metadata)
+			{
+				score.metadata.title = reader.readString();
+				score.metadata.author = reader.readString();
+				score.metadata.artist = reader.readString();
+				score.metadata.musicFile = reader.readString();
+				score.metadata.jacketFile = reader.readString();
+				score.metadata.musicOffset = reader.readSingle();
+			}
+
+			reader.seek(recordEnd);
+		}
+
+		score.invalidateNoteIndex();
+		score.invalidateTempoMap();
+		score.invalidateMeasureMap();
+	}
+
+	void EditJournal::writeNote(const Note& note, IO::BinaryWriter& writer)
+	{
+		writer.writeInt32((int)note.getType());
+		writer.writeInt32(toJournalID(note.parentID));
+		writer.writeInt32(note.tick);
+		writer.writeInt32(note.lane);
+		writer.writeInt32(note.width);
+		writer.writeInt32(note.critical);
+		writer.writeInt32((int)note.flick);
+	}
+
+	Note EditJournal::readNote(IO::BinaryReader& reader)
+	{
+		Note note((NoteType)reader.readInt32());
+		note.parentID = toSessionID(reader.readInt32());
+		note.tick = reader.readInt32();
+		note.lane = reader.readInt32();
+		note.width = reader.readInt32();
+		note.critical = reader.readInt32();
+		note.flick = (FlickType)reader.readInt32();
+
+		return note;
+	}
+
+	void EditJournal::writeHold(const HoldNote& hold, IO::BinaryWriter& writer)
+	{
+		writer.writeInt32((int)hold.start.ease);
+		writer.writeInt32(hold.steps.size());
+		for (const auto& step : hold.steps)
+		{
+			writer.writeInt32(toJournalID(step.ID));
+			writer.writeInt32((int)step.type);
+			writer.writeInt32((int)step.ease);
+		}
+
+		writer.writeInt32(toJournalID(hold.end));
+	}
+
+	HoldNote EditJournal::readHold(IO::BinaryReader& reader)
+	{
+		HoldNote hold;
+		hold.start.type = HoldStepType::Normal;
+		hold.start.ease = (EaseType)reader.readInt32();
+
+		int stepCount = reader.readInt32();
+		hold.steps.reserve(stepCount);
+		for (int i = 0; i < stepCount; ++i)
+		{
+			HoldStep step;
+			step.ID = toSessionID(reader.readInt32());
+			step.type = (HoldStepType)reader.readInt32();
+			step.ease = (EaseType)reader.readInt32();
+			hold.steps.push_back(step);
+		}
+
+		hold.end = toSessionID(reader.readInt32());
+		return hold;
+	}
+
+	bool EditJournal::openStream()
+	{
+		if (stream)
+			return true;
+
+		// drop records that were discarded or cut short before appending after them
+		if (diskSize != size)
+		{
+			truncate(size);
+			if (diskSize != size)
+				return false;
+		}
+
+		stream = IO::openFile(journalFilename, "ab");
+		if (!stream)
+			return false;
+
+		if (!size)
+		{
+			IO::BinaryWriter header(journalFilename);
+			header.writeString(journalSignature);
+			header.writeInt32(journalVersion);
+			header.writeInt32(baseChecksum);
+			header.writeInt32(baseNoteCount);
+
+			const std::vector<uint8_t>& data = header.getData();
+			if (fwrite(data.data(), 1, data.size(), stream) != data.size())
+			{
+				fclose(stream);
+				stream = nullptr;
+				return false;
+			}
+
+			size = committedSize = diskSize = data.size();
+		}
+
+		return true;
+	}
+
+	bool EditJournal::writeRecord(RecordType type, const std::vector<uint8_t>& payload)
+	{
+		if (!openStream())
+			return false;
+
+		uint32_t header[2] = { (uint32_t)type, (uint32_t)payload.size() };
+		bool written = fwrite(header, 1, recordHeaderSize, stream) == recordHeaderSize;
+		written &= fwrite(payload.data(), 1, payload.size(), stream) == payload.size();
+		written &= fflush(stream) == 0;
+
+		if (!written)
+		{
+			// the journal can no longer be trusted so the next save rewrites the file
+			fclose(stream);
+			stream = nullptr;
+			active = false;
+			return false;
+		}
+
+		size += recordHeaderSize + payload.size();
+		diskSize = size;
+		return true;
+	}
+
+	void EditJournal::truncate(size_t length)
+	{
+		if (stream)
+			fclose(stream);
+
+		stream = nullptr;
+		std::error_code error;
+		if (!length)
+		{
+			std::filesystem::remove(IO::mbToWideStr(journalFilename), error);
+			diskSize = 0;
+			return;
+		}
+
+		std::filesystem::resize_file(IO::mbToWideStr(journalFilename), length, error);
+		if (error)
+			return;
+
+		diskSize = length;
+	}
+
+	void EditJournal::append(const History& change, bool undo)
+	{
+		if (!active)
+			return;
+
+		IO::BinaryWriter writer(journalFilename);
+
+		writer.writeInt32(change.notes.size());
+		for (const auto& note : change.notes)
+		{
+			const std::optional<Note>& state = undo ? note.before : note.after;
+			writer.writeInt32(toJournalID(note.ID));
+			writer.writeInt32(state.has_value());
+			if (state)
+				writeNote(*state, writer);
+		}
+
+		writer.writeInt32(change.holds.size());
+		for (const auto& hold : change.holds)
+		{
+			const std::optional<HoldNote>& state = undo ? hold.before : hold.after;
+			writer.writeInt32(toJournalID(hold.ID));
+			writer.writeInt32(state.has_value());
+			if (state)
+				writeHold(*state, writer);
+		}
+
+		uint32_t events = 0;
+		if (change.tempoChanges.recorded) events |= EventsMaskTempo;
+		if (change.timeSignatures.recorded) events |= EventsMaskTimeSignature;
+		if (change.hiSpeedChanges.recorded) events |= EventsMaskHiSpeed;
+		writer.writeInt32(events);
+
+		if (change.tempoChanges.recorded)
+		{
+			const auto& tempos = undo ? change.tempoChanges.before : change.tempoChanges.after;
+			writer.writeInt32(tempos.size());
+			for (const auto& tempo : tempos)
+			{
+				writer.writeInt32(tempo.tick);
+				writer.writeSingle(tempo.bpm);
+			}
+		}
+
+		if (change.timeSignatures.recorded)
+		{
+			const auto& timeSignatures = undo ? change.timeSignatures.before : change.timeSignatures.after;
+			writer.writeInt32(timeSignatures.size());
+			for (const auto& [_, timeSignature] : timeSignatures)
+			{
+				writer.writeInt32(timeSignature.measure);
+				writer.writeInt32(timeSignature.numerator);
+				writer.writeInt32(timeSignature.denominator);
+			}
+		}
+
+		if (change.hiSpeedChanges.recorded)
+		{
+			const auto& hiSpeeds = undo ? change.hiSpeedChanges.before : change.hiSpeedChanges.after;
+			writer.writeInt32(hiSpeeds.size());
+			for (const auto& hiSpeed : hiSpeeds)
+			{
+				writer.writeInt32(hiSpeed.tick);
+				writer.writeSingle(hiSpeed.speed);
+			}
+		}
+
+		writeRecord(RecordType::Edit, writer.getData());
+	}
+
+	bool EditJournal::commit(const ScoreMetadata& metadata)
+	{
+		if (!active)
+			return false;
+
+		bool written = false;
+		if (!sameMetadata(metadata, committedMetadata))
+		{
+			IO::BinaryWriter writer(journalFilename);
+			writer.writeString(metadata.title);
+			writer.writeString(metadata.author);
+			writer.writeString(metadata.artist);
+			writer.writeString(metadata.musicFile);
+			writer.writeString(metadata.jacketFile);
+			writer.writeSingle(metadata.musicOffset);
+
+			if (!writeRecord(RecordType::Metadata, writer.getData()))
+				return false;
+
+			written = true;
+		}
+
+		if (size != committedSize)
+		{
+			if (!writeRecord(RecordType::Commit, {}))
+				return false;
+
+			written = true;
+		}
+
+		// the commit record is the save, so unlike edits it has to reach the disk
+		if (written && !IO::syncFile(stream))
+		{
+			fclose(stream);
+			stream = nullptr;
+			active = false;
+			return false;
+		}
+
+		committedSize = size;
+		committedMetadata = metadata;
+		return true;
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "HistoryManager.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace IO
+{
+	class BinaryReader;
+	class BinaryWriter;
+}
+
+namespace MikuMikuWorld
+{
+	// append-only log of edits made to a MMWS file, stored next to it as .mmwj.
+	// saving appends a commit record instead of rewriting the file and loading
+	// replays the committed edits over the file. edits after the last commit
+	// are left by a session that did not save or exit properly
+	class EditJournal
+	{
+	private:
+		enum class RecordType : uint32_t
+		{
+			Edit,
+			Metadata,
+			Commit
+		};
+
+		std::string journalFilename;
+		uint32_t baseChecksum{};
+		size_t baseSize{};
+		int baseNoteCount{};
+		bool active{ false };
+
+		FILE* stream{ nullptr };
+		size_t size{};
+		size_t committedSize{};
+		size_t diskSize{};
+		ScoreMetadata committedMetadata{};
+
+		// bytes of the journal read on load, kept until the uncommitted part is dealt with
+		std::vector<uint8_t> loadedData;
+		size_t loadedEnd{};
+
+		// journal IDs are the note's position in the MMWS file followed by
+		// notes added since, which keeps them valid across reloads
+		std::unordered_map<int, int> journalIDs;
+		std::unordered_map<int, int> sessionIDs;
+		int nextJournalID{};
+
+		void mapBaseNotes(const MmwsLayout& layout);
+		int toJournalID(int id);
+		int toSessionID(int id);
+
+		bool openStream();
+		bool writeRecord(RecordType type, const std::vector<uint8_t>& payload);
+		void truncate(size_t length);
+
+		// returns the end of the last commit record and sets loadedEnd to the end of the last whole record
+		size_t scanRecords(size_t begin);
+		void applyRecords(Score& score, size_t begin, size_t end);
+
+		void writeNote(const Note& note, IO::BinaryWriter& writer);
+		Note readNote(IO::BinaryReader& reader);
+		void writeHold(const HoldNote& hold, IO::BinaryWriter& writer);
+		HoldNote readHold(IO::BinaryReader& reader);
+
+	public:
+		EditJournal() = default;
+		EditJournal(const EditJournal&) = delete;
+		EditJournal& operator=(const EditJournal&) = delete;
+		~EditJournal();
+
+		static std::string getJournalFilename(const std::string& scoreFilename);
+
+		/// <summary>
+		/// Replays the committed edits of the file's journal over the loaded score.
+		/// the journal stays inactive until setActive is called
+		/// </summary>
+		void load(const std::string& scoreFilename, const MmwsLayout& layout, Score& score);
+
+		/// <summary>
+		/// Starts an empty journal for a score that was just written in full
+		/// </summary>
+		void reset(const std::string& scoreFilename, const MmwsLayout& layout, const ScoreMetadata& metadata, bool active);
+
+		/// <summary>
+		/// Stops journaling and drops the edits appended since the last commit
+		/// </summary>
+		void close();
+
+		inline void setActive(bool value) { active = value && journalFilename.size(); }
+		inline bool isActive() const { return active; }
+
+		bool hasUncommittedEdits() const;
+		void replayUncommitted(Score& score);
+		void discardUncommitted();
+
+		// whether saving to the file can append a commit instead of rewriting it
+		bool canCommit(const std::string& scoreFilename) const;
+
+		void append(const History& change, bool undo);
+
+		/// <summary>
+		/// Marks the edits appended so far as saved. returns false if the journal could not be written
+		/// </summary>
+		bool commit(const ScoreMetadata& metadata);
+	};
+}
@@ -28,7 +28,7 @@ namespace IO
 		if (stream)
 			close();
 
-		stream = _wfopen(filename.c_str(), mode);
+		stream = openFile(wideStringToMb(filename), wideStringToMb(mode).c_str());
 	}
 
 	void File::open(const std::string& filename, const char* mode)
@@ -170,7 +170,6 @@ namespace IO
 
 	bool File::exists(const std::string& path)
 	{
-		std::wstring wPath = mbToWideStr(path);
-		return std::filesystem::exists(wPath);
+		return std::filesystem::exists(std::filesystem::u8path(path));
 	}
 }
\ No newline at end of file
@@ -1,37 +1,167 @@
 #include "HistoryManager.h"
+#include "EditJournal.h"
 
 namespace MikuMikuWorld
 {
-	Score HistoryManager::undo()
+	template <typename T>
+	static std::optional<T> findItem(const CowMap<int, T>& items, int id)
 	{
-		History history = undoHistory.top();
-		redoHistory.push(history);
-		undoHistory.pop();
+		auto it = items.find(id);
+		return it != items.end() ? std::optional<T>{ it->second } : std::nullopt;
+	}
 
-		return history.prev;
+	template <typename T>
+	static void applyChange(CowMap<int, T>& items, int id, const std::optional<T>& state)
+	{
+		if (state)
+			items[id] = *state;
+		else
+			items.erase(id);
 	}
 
-	Score HistoryManager::redo()
+	static std::optional<Note> findItem(const NoteStore& notes, int id)
 	{
-		History history = redoHistory.top();
-		undoHistory.push(history);
-		redoHistory.pop();
+		return notes.contains(id) ? std::optional<Note>{ notes.at(id) } : std::nullopt;
+	}
+
+	static void applyChange(NoteStore& notes, int id, const std::optional<Note>& state)
+	{
+		if (state)
+			notes.insert(*state);
+		else
+			notes.erase(id);
+	}
+
+	History::History(const std::string& _description)
+		: description{ _description }
+	{
+	}
+
+	void History::recordNote(const Score& score, int id)
+	{
+		if (recordedNotes.insert(id).second)
+			notes.push_back({ id, findItem(score.notes, id), std::nullopt });
+	}
+
+	void History::recordHold(const Score& score, int id)
+	{
+		if (recordedHolds.insert(id).second)
+			holds.push_back({ id, findItem(score.holdNotes, id), std::nullopt });
+	}
+
+	void History::recordTempoChanges(const Score& score)
+	{
+		if (!tempoChanges.recorded)
+			tempoChanges = { true, score.tempoChanges, {} };
+	}
+
+	void History::recordTimeSignatures(const Score& score)
+	{
+		if (!timeSignatures.recorded)
+			timeSignatures = { true, score.timeSignatures, {} };
+	}
+
+	void History::recordHiSpeedChanges(const Score& score)
+	{
+		if (!hiSpeedChanges.recorded)
+			hiSpeedChanges = { true, score.hiSpeedChanges, {} };
+	}
+
+	void History::commit(const Score& score)
+	{
+		for (auto& change : notes)
+			change.after = findItem(score.notes, change.ID);
+
+		for (auto& change : holds)
+			change.after = findItem(score.holdNotes, change.ID);
 
-		return history.curr;
+		if (tempoChanges.recorded)
+			tempoChanges.after = score.tempoChanges;
+
+		if (timeSignatures.recorded)
+			timeSignatures.after = score.timeSignatures;
+
+		if (hiSpeedChanges.recorded)
+			hiSpeedChanges.after = score.hiSpeedChanges;
+
+		// only needed while recording
+		recordedNotes.clear();
+		recordedHolds.clear();
+	}
+
+	bool History::empty() const
+	{
+		return notes.empty() && holds.empty() && !tempoChanges.recorded && !timeSignatures.recorded && !hiSpeedChanges.recorded;
+	}
+
+	void History::undo(Score& score) const
+	{
+		for (auto it = notes.rbegin(); it != notes.rend(); ++it)
+			applyChange(score.notes, it->ID, it->before);
+
+		for (auto it = holds.rbegin(); it != holds.rend(); ++it)
+			applyChange(score.holdNotes, it->ID, it->before);
+
+		if (tempoChanges.recorded)
+			score.tempoChanges = tempoChanges.before;
+
+		if (timeSignatures.recorded)
+			score.timeSignatures = timeSignatures.before;
+
+		if (hiSpeedChanges.recorded)
+			score.hiSpeedChanges = hiSpeedChanges.before;
+	}
+
+	void History::redo(Score& score) const
+	{
+		for (const auto& change : notes)
+			applyChange(score.notes, change.ID, change.after);
+
+		for (const auto& change : holds)
+			applyChange(score.holdNotes, change.ID, change.after);
+
+		if (tempoChanges.recorded)
+			score.tempoChanges = tempoChanges.after;
+
+		if (timeSignatures.recorded)
+			score.timeSignatures = timeSignatures.after;
+
+		if (hiSpeedChanges.recorded)
+			score.hiSpeedChanges = hiSpeedChanges.after;
 	}
 
-	void HistoryManager::pushHistory(const std::string& description, const Score& prev, const Score& curr)
+	void HistoryManager::undo(Score& score)
 	{
-		History history{ description, prev, curr };
-		pushHistory(history);
+		undoHistory.top().undo(score);
+		if (journal)
+			journal->append(undoHistory.top(), true);
+
+		redoHistory.push(std::move(undoHistory.top()));
+		undoHistory.pop();
+		++version;
+	}
+
+	void HistoryManager::redo(Score& score)
+	{
+		redoHistory.top().redo(score);
+		if (journal)
+			journal->append(redoHistory.top(), false);
+
+		undoHistory.push(std::move(redoHistory.top()));
+		redoHistory.pop();
+		++version;
 	}
 
 	void HistoryManager::pushHistory(const History& history)
 	{
 		undoHistory.push(history);
-		
+		if (journal)
+			journal->append(history, false);
+
 		while (!redoHistory.empty())
 			redoHistory.pop();
+
+		++version;
 	}
 
 	void HistoryManager::clear()
@@ -41,6 +171,8 @@ namespace MikuMikuWorld
 
 		while (!redoHistory.empty())
 			redoHistory.pop();
+
+		++version;
 	}
 
 	bool HistoryManager::hasUndo() const
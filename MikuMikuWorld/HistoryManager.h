@@ -2,16 +2,66 @@
 #include <stack>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
+#include <optional>
 #include <string>
 #include "Score.h"
 
 namespace MikuMikuWorld
 {
-	struct History
+	// state of a single note or hold before and after an edit.
+	// an empty before means the item was added and an empty after means it was removed
+	template <typename T>
+	struct HistoryChange
 	{
+		int ID;
+		std::optional<T> before;
+		std::optional<T> after;
+	};
+
+	template <typename T>
+	struct EventsChange
+	{
+		bool recorded{ false };
+		T before;
+		T after;
+	};
+
+	class EditJournal;
+
+	class History
+	{
+	private:
+		std::vector<HistoryChange<Note>> notes;
+		std::vector<HistoryChange<HoldNote>> holds;
+		std::unordered_set<int> recordedNotes;
+		std::unordered_set<int> recordedHolds;
+
+		EventsChange<std::vector<Tempo>> tempoChanges;
+		EventsChange<std::map<int, TimeSignature>> timeSignatures;
+		EventsChange<std::vector<HiSpeedChange>> hiSpeedChanges;
+
+		friend class EditJournal;
+
+	public:
 		std::string description;
-		Score prev;
-		Score curr;
+
+		History(const std::string& description = "");
+
+		// capture the state of an item before it is added, edited or removed.
+		// recording the same item more than once keeps the first state
+		void recordNote(const Score& score, int id);
+		void recordHold(const Score& score, int id);
+		void recordTempoChanges(const Score& score);
+		void recordTimeSignatures(const Score& score);
+		void recordHiSpeedChanges(const Score& score);
+
+		// capture the state of every recorded item after the edit
+		void commit(const Score& score);
+		bool empty() const;
+
+		void undo(Score& score) const;
+		void redo(Score& score) const;
 	};
 
 	class HistoryManager
@@ -19,10 +69,18 @@ namespace MikuMikuWorld
 	private:
 		std::stack<History> undoHistory;
 		std::stack<History> redoHistory;
+		int version{};
+		EditJournal* journal{ nullptr };
 
 	public:
-		Score undo();
-		Score redo();
+		// changes whenever the score is edited, undone, redone or replaced
+		inline int getVersion() const { return version; }
+
+		// every change made through the manager is appended to the journal
+		inline void setJournal(EditJournal* _journal) { journal = _journal; }
+
+		void undo(Score& score);
+		void redo(Score& score);
 
 		int undoCount() const;
 		int redoCount() const;
@@ -30,9 +88,8 @@ namespace MikuMikuWorld
 		std::string peekRedo() const;
 
 		void pushHistory(const History& history);
-		void pushHistory(const std::string& description, const Score& prev, const Score& curr);
 		void clear();
 		bool hasUndo() const;
 		bool hasRedo() const;
 	};
-}
\ No newline at end of file
+}
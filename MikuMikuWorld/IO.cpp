@@ -1,11 +1,19 @@
 #include "IO.h"
-#include "IO.h"
+#include <filesystem>
+
+#ifdef _WIN32
 #include <Windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace IO
 {
 	MessageBoxResult messageBox(std::string title, std::string message, MessageBoxButtons buttons, MessageBoxIcon icon, void* parentWindow)
 	{
+#ifdef _WIN32
 		UINT flags = 0;
 		switch (icon)
 		{
@@ -36,6 +44,11 @@ namespace IO
 		case IDOK: return MessageBoxResult::Ok;
 		default: return MessageBoxResult::None;
 		}
+#else
+		// there is no native dialog to show, so the message goes to the console without an answer
+		fprintf(stderr, "%s: %s\n", title.c_str(), message.c_str());
+		return MessageBoxResult::None;
+#endif
 	}
 
 	char* reverse(char* str)
@@ -143,24 +156,138 @@ namespace IO
 
 	std::string wideStringToMb(const std::wstring& str)
 	{
+#ifdef _WIN32
 		int size = WideCharToMultiByte(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0, NULL, NULL);
 		std::string result(size, 0);
 		WideCharToMultiByte(CP_UTF8, 0, &str[0], (int)str.size(), &result[0], size, NULL, NULL);
 
 		return result;
+#else
+		// wchar_t holds whole code points here, and the standard conversions go through the C locale
+		std::string result;
+		result.reserve(str.size());
+		for (wchar_t c : str)
+		{
+			uint32_t code = c;
+			if (code < 0x80)
+			{
+				result.push_back(code);
+			}
+			else if (code < 0x800)
+			{
+				result.push_back(0xC0 | (code >> 6));
+				result.push_back(0x80 | (code & 0x3F));
+			}
+			else if (code < 0x10000)
+			{
+				result.push_back(0xE0 | (code >> 12));
+				result.push_back(0x80 | ((code >> 6) & 0x3F));
+				result.push_back(0x80 | (code & 0x3F));
+			}
+			else
+			{
+				result.push_back(0xF0 | (code >> 18));
+				result.push_back(0x80 | ((code >> 12) & 0x3F));
+				result.push_back(0x80 | ((code >> 6) & 0x3F));
+				result.push_back(0x80 | (code & 0x3F));
+			}
+		}
+
+		return result;
+#endif
 	}
 
 	std::wstring mbToWideStr(const std::string& str)
 	{
+#ifdef _WIN32
 		int size = MultiByteToWideChar(CP_UTF8, 0, &str[0], str.size(), NULL, 0);
 		std::wstring wResult(size, 0);
 		MultiByteToWideChar(CP_UTF8, 0, &str[0], str.size(), &wResult[0], size);
 
 		return wResult;
+#else
+		std::wstring wResult;
+		wResult.reserve(str.size());
+		for (size_t i = 0; i < str.size();)
+		{
+			uint8_t lead = str[i];
+			int length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+			uint32_t code = length == 1 ? lead : lead & (0x3F >> (length - 1));
+			for (int j = 1; j < length && i + j < str.size(); ++j)
+				code = (code << 6) | (str[i + j] & 0x3F);
+
+			wResult.push_back(code);
+			i += length;
+		}
+
+		return wResult;
+#endif
 	}
 
 	std::string concat(const char* s1, const char* s2, const char* join)
 	{
 		return std::string(s1).append(join).append(s2);
 	}
+
+	FILE* openFile(const std::string& filename, const char* mode)
+	{
+#ifdef _WIN32
+		return _wfopen(mbToWideStr(filename).c_str(), mbToWideStr(mode).c_str());
+#else
+		return fopen(filename.c_str(), mode);
+#endif
+	}
+
+	bool syncFile(FILE* stream)
+	{
+		if (fflush(stream) != 0)
+			return false;
+
+#ifdef _WIN32
+		return _commit(_fileno(stream)) == 0;
+#else
+		return fsync(fileno(stream)) == 0;
+#endif
+	}
+
+	bool replaceFile(const std::string& source, const std::string& destination)
+	{
+#ifdef _WIN32
+		return MoveFileExW(mbToWideStr(source).c_str(), mbToWideStr(destination).c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		std::error_code error;
+		std::filesystem::rename(source, destination, error);
+		if (error)
+			return false;
+
+		// the rename itself is only durable once the directory entry is written
+		std::string directory = std::filesystem::path(destination).parent_path().string();
+		int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+		if (fd != -1)
+		{
+			fsync(fd);
+			close(fd);
+		}
+
+		return true;
+#endif
+	}
+
+	bool removeFile(const std::string& filename)
+	{
+		std::error_code error;
+		return std::filesystem::remove(std::filesystem::u8path(filename), error);
+	}
+
+	uint32_t fnv1a(const uint8_t* data, size_t size)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= data[i];
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <cstdio>
 #include <string>
 #include <vector>
 #include <stdexcept>
@@ -51,6 +52,19 @@ namespace IO
 
 	std::string concat(const char* s1, const char* s2, const char* join = "");
 
+	// file operations taking UTF-8 paths, implemented with the platform's own calls
+	FILE* openFile(const std::string& filename, const char* mode);
+
+	// flushes the stream and waits until its data has reached the disk
+	bool syncFile(FILE* stream);
+
+	// moves source over destination in one step, so readers see either the old or the new file
+	bool replaceFile(const std::string& source, const std::string& destination);
+	bool removeFile(const std::string& filename);
+
+	// 32-bit FNV-1a hash used to tell whether a file changed
+	uint32_t fnv1a(const uint8_t* data, size_t size);
+
 	template<typename ... Args>
 	std::string formatString(const char* format, Args ... args)
 	{
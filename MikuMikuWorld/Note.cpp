@@ -1,12 +1,13 @@
 #include "Note.h"
 #include "Constants.h"
 #include "Score.h"
+#include "NoteStore.h"
 #include <algorithm>
 
 namespace MikuMikuWorld
 {
-	int nextID = 1;
-	int nextSkillID = 1;
+	thread_local int nextID = 1;
+	thread_local int nextSkillID = 1;
 
 	Note::Note(NoteType _type) :
 		type{ _type }, parentID{ -1 }, flick{ FlickType::None }, critical{ false }
@@ -34,7 +35,7 @@ namespace MikuMikuWorld
 		nextID = 1;
 	}
 
-	void cycleFlick(Note& note)
+	void cycleFlick(NoteRef note)
 	{
 		if (note.getType() == NoteType::Hold || note.getType() == NoteType::HoldMid)
 			return;
@@ -115,9 +116,9 @@ namespace MikuMikuWorld
 		return -1;
 	}
 
-	std::string getNoteSE(const Note& note, const Score& score)
+	const char* getNoteSE(const Note& note, const Score& score)
 	{
-		std::string se = "";
+		const char* se = "";
 		if (note.getType() == NoteType::HoldMid)
 		{
 			const HoldNote& hold = score.holdNotes.at(note.parentID);
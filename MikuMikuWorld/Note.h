@@ -6,8 +6,10 @@
 namespace MikuMikuWorld
 {
 	struct Score;
+	class NoteRef;
 
-	extern int nextID;
+	// per thread so the batch converter can load several scores at once
+	extern thread_local int nextID;
 
 	class Note final
 	{
@@ -52,7 +54,7 @@ namespace MikuMikuWorld
 
 	void resetNextID();
 
-	void cycleFlick(Note& note);
+	void cycleFlick(NoteRef note);
 	void cycleStepEase(HoldStep& note);
 	void cycleStepType(HoldStep& note);
 	void sortHoldSteps(const Score& score, HoldNote& note);
@@ -60,5 +62,5 @@ namespace MikuMikuWorld
 
 	int getFlickArrowSpriteIndex(const Note& note);
 	int getNoteSpriteIndex(const Note& note);
-	std::string getNoteSE(const Note& note, const Score& score);
+	const char* getNoteSE(const Note& note, const Score& score);
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "NoteStore.h"
+
+namespace MikuMikuWorld
+{
+	NoteRef::NoteRef(NoteStore::Chunk& chunk, int index) :
+		type{ chunk.types[index] }, ID{ chunk.ids[index] }, parentID{ chunk.parentIDs[index] },
+		tick{ chunk.ticks[index] }, lane{ chunk.lanes[index] }, width{ chunk.widths[index] },
+		critical{ chunk.criticals[index] }, flick{ chunk.flicks[index] }
+	{
+	}
+
+	NoteRef::NoteRef(NoteStore& store, int slot) :
+		NoteRef(store.writableChunk(slot), NoteStore::indexOf(slot))
+	{
+	}
+
+	bool NoteRef::isFlick() const
+	{
+		return flick != FlickType::None && type != NoteType::Hold && type != NoteType::HoldMid;
+	}
+
+	bool NoteRef::hasEase() const
+	{
+		return type == NoteType::Hold || type == NoteType::HoldMid;
+	}
+
+	NoteRef::operator Note() const
+	{
+		Note note(type);
+		note.ID = ID;
+		note.parentID = parentID;
+		note.tick = tick;
+		note.lane = lane;
+		note.width = width;
+		note.critical = critical;
+		note.flick = flick;
+
+		return note;
+	}
+
+	NoteRef& NoteRef::operator=(const Note& note)
+	{
+		type = note.getType();
+		ID = note.ID;
+		parentID = note.parentID;
+		tick = note.tick;
+		lane = note.lane;
+		width = note.width;
+		critical = note.critical;
+		flick = note.flick;
+
+		return *this;
+	}
+
+	NoteStore::const_iterator::const_iterator(const NoteStore* _store, int _slot)
+		: store{ _store }, slot{ _slot }
+	{
+		skipUnused();
+	}
+
+	void NoteStore::const_iterator::skipUnused()
+	{
+		while (slot < store->slotCount() && !store->isUsed(slot))
+			++slot;
+	}
+
+	std::pair<int, Note> NoteStore::const_iterator::operator*() const
+	{
+		return { store->getID(slot), store->readSlot(slot) };
+	}
+
+	NoteStore::const_iterator::Pointer NoteStore::const_iterator::operator->() const
+	{
+		return Pointer{ **this };
+	}
+
+	NoteStore::const_iterator& NoteStore::const_iterator::operator++()
+	{
+		++slot;
+		skipUnused();
+		return *this;
+	}
+
+	NoteStore::NoteStore()
+	{
+	}
+
+	NoteStore::Chunk& NoteStore::writableChunk(int slot)
+	{
+		std::shared_ptr<Chunk>& chunk = chunks[slot >> chunkBits];
+		if (!isExclusive(chunk))
+			chunk = std::make_shared<Chunk>(*chunk);
+
+		return *chunk;
+	}
+
+	int NoteStore::findSlot(int id) const
+	{
+		auto it = slots.find(id);
+		return it != slots.end() ? it->second : -1;
+	}
+
+	int NoteStore::allocateSlot()
+	{
+		int slot;
+		if (freeSlots.size())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			slot = slotTotal++;
+			if ((slot >> chunkBits) >= chunks.size())
+				chunks.push_back(std::make_shared<Chunk>());
+		}
+
+		writableChunk(slot).used[indexOf(slot)] = true;
+		return slot;
+	}
+
+	void NoteStore::writeSlot(int slot, const Note& note)
+	{
+		Chunk& chunk = writableChunk(slot);
+		const int index = indexOf(slot);
+
+		chunk.ids[index] = note.ID;
+		chunk.parentIDs[index] = note.parentID;
+		chunk.ticks[index] = note.tick;
+		chunk.lanes[index] = note.lane;
+		chunk.widths[index] = note.width;
+		chunk.types[index] = note.getType();
+		chunk.flicks[index] = note.flick;
+		chunk.criticals[index] = note.critical;
+	}
+
+	Note NoteStore::readSlot(int slot) const
+	{
+		const Chunk& chunk = chunkOf(slot);
+		const int index = indexOf(slot);
+
+		Note note(chunk.types[index]);
+		note.ID = chunk.ids[index];
+		note.parentID = chunk.parentIDs[index];
+		note.tick = chunk.ticks[index];
+		note.lane = chunk.lanes[index];
+		note.width = chunk.widths[index];
+		note.critical = chunk.criticals[index];
+		note.flick = chunk.flicks[index];
+
+		return note;
+	}
+
+	void NoteStore::reserve(size_t count)
+	{
+		chunks.reserve((count + chunkSize - 1) / chunkSize);
+		slots.reserve(count);
+	}
+
+	void NoteStore::clear()
+	{
+		chunks.clear();
+		slotTotal = 0;
+		freeSlots.clear();
+		slots.clear();
+	}
+
+	NoteStore::const_iterator NoteStore::begin() const
+	{
+		return const_iterator(this, 0);
+	}
+
+	NoteStore::const_iterator NoteStore::end() const
+	{
+		return const_iterator(this, slotCount());
+	}
+
+	NoteStore::const_iterator NoteStore::find(int id) const
+	{
+		int slot = findSlot(id);
+		return slot != -1 ? const_iterator(this, slot) : end();
+	}
+
+	Note NoteStore::at(int id) const
+	{
+		return readSlot(slots.at(id));
+	}
+
+	NoteRef NoteStore::at(int id)
+	{
+		return NoteRef(*this, std::as_const(slots).at(id));
+	}
+
+	NoteRef NoteStore::operator[](int id)
+	{
+		int slot = findSlot(id);
+		if (slot != -1)
+			return NoteRef(*this, slot);
+
+		Note note;
+		note.ID = id;
+		note.tick = note.lane = note.width = 0;
+
+		slot = allocateSlot();
+		writeSlot(slot, note);
+		slots[id] = slot;
+
+		return NoteRef(*this, slot);
+	}
+
+	void NoteStore::insert(const Note& note)
+	{
+		int slot = findSlot(note.ID);
+		if (slot == -1)
+		{
+			slot = allocateSlot();
+			slots[note.ID] = slot;
+		}
+
+		writeSlot(slot, note);
+	}
+
+	size_t NoteStore::erase(int id)
+	{
+		int slot = findSlot(id);
+		if (slot == -1)
+			return 0;
+
+		writableChunk(slot).used[indexOf(slot)] = false;
+		freeSlots.push_back(slot);
+		slots.erase(id);
+
+		return 1;
+	}
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "Note.h"
+#include "CowMap.h"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace MikuMikuWorld
+{
+	class NoteRef;
+
+	// notes stored as parallel arrays indexed by slot.
+	// IDs map to stable slots and removed slots are reused by later inserts.
+	// the arrays are split into fixed size chunks shared between copies of the store,
+	// so copying is cheap and an edit only duplicates the chunk it touches
+	class NoteStore
+	{
+	private:
+		static constexpr int chunkBits = 8;
+		static constexpr int chunkSize = 1 << chunkBits;
+
+		struct Chunk
+		{
+			int ids[chunkSize];
+			int parentIDs[chunkSize];
+			int ticks[chunkSize];
+			int lanes[chunkSize];
+			int widths[chunkSize];
+			NoteType types[chunkSize];
+			FlickType flicks[chunkSize];
+			bool criticals[chunkSize];
+			bool used[chunkSize];
+		};
+
+		std::vector<std::shared_ptr<Chunk>> chunks;
+		int slotTotal{ 0 };
+
+		std::vector<int> freeSlots;
+
+		// sharded so that adding or removing a note copies one shard of the IDs
+		CowMap<int, int> slots;
+
+		inline const Chunk& chunkOf(int slot) const { return *chunks[slot >> chunkBits]; }
+		inline static constexpr int indexOf(int slot) { return slot & (chunkSize - 1); }
+
+		Chunk& writableChunk(int slot);
+		int findSlot(int id) const;
+
+		int allocateSlot();
+		void writeSlot(int slot, const Note& note);
+		Note readSlot(int slot) const;
+
+		friend class NoteRef;
+
+	public:
+		class const_iterator
+		{
+		private:
+			const NoteStore* store;
+			int slot;
+
+			void skipUnused();
+
+		public:
+			// iterating yields copies, edits must go through NoteStore::at
+			struct Pointer
+			{
+				std::pair<int, Note> value;
+				inline const std::pair<int, Note>* operator->() const { return &value; }
+			};
+
+			const_iterator(const NoteStore* store, int slot);
+
+			std::pair<int, Note> operator*() const;
+			Pointer operator->() const;
+			const_iterator& operator++();
+
+			inline bool operator==(const const_iterator& other) const { return slot == other.slot; }
+			inline bool operator!=(const const_iterator& other) const { return slot != other.slot; }
+		};
+
+		NoteStore();
+
+		inline size_t size() const { return slots.size(); }
+		inline bool empty() const { return slots.empty(); }
+		inline bool contains(int id) const { return findSlot(id) != -1; }
+
+		void reserve(size_t count);
+		void clear();
+
+		const_iterator begin() const;
+		const_iterator end() const;
+		const_iterator find(int id) const;
+
+		Note at(int id) const;
+		NoteRef at(int id);
+
+		// inserts a default note with the given ID if it does not exist
+		NoteRef operator[](int id);
+		void insert(const Note& note);
+		size_t erase(int id);
+
+		// direct access to the arrays for linear passes over every note.
+		// slots for which isUsed is false hold removed notes and must be skipped
+		inline int slotCount() const { return slotTotal; }
+		inline bool isUsed(int slot) const { return chunkOf(slot).used[indexOf(slot)]; }
+		inline int getID(int slot) const { return chunkOf(slot).ids[indexOf(slot)]; }
+		inline int getParentID(int slot) const { return chunkOf(slot).parentIDs[indexOf(slot)]; }
+		inline int getTick(int slot) const { return chunkOf(slot).ticks[indexOf(slot)]; }
+		inline int getLane(int slot) const { return chunkOf(slot).lanes[indexOf(slot)]; }
+		inline int getWidth(int slot) const { return chunkOf(slot).widths[indexOf(slot)]; }
+		inline NoteType getType(int slot) const { return chunkOf(slot).types[indexOf(slot)]; }
+		inline FlickType getFlick(int slot) const { return chunkOf(slot).flicks[indexOf(slot)]; }
+		inline bool isCritical(int slot) const { return chunkOf(slot).criticals[indexOf(slot)]; }
+	};
+
+	// writable view of a note's fields inside a NoteStore.
+	// invalidated when the store is copied, since the copy shares the chunk it points into
+	class NoteRef
+	{
+	private:
+		NoteType& type;
+
+		NoteRef(NoteStore::Chunk& chunk, int index);
+
+	public:
+		int& ID;
+		int& parentID;
+		int& tick;
+		int& lane;
+		int& width;
+		bool& critical;
+		FlickType& flick;
+
+		NoteRef(NoteStore& store, int slot);
+
+		inline constexpr NoteType getType() const { return type; }
+
+		bool isFlick() const;
+		bool hasEase() const;
+
+		operator Note() const;
+		NoteRef& operator=(const Note& note);
+	};
+}
@@ -1,42 +1,25 @@
 #pragma once
 #include <DirectXMath.h>
-#include <array>
+#include <DirectXPackedVector.h>
 
 namespace MikuMikuWorld
 {
-	struct Vertex
+	// layout of the vertices uploaded to the GPU. positions are already transformed,
+	// colors are 8-bit per channel and UVs are normalized to 16 bits
+	struct PackedVertex
 	{
-		DirectX::XMVECTOR position;
-		DirectX::XMVECTOR color;
-		DirectX::XMVECTOR uv;
+		DirectX::XMFLOAT2 position;
+		DirectX::PackedVector::XMUBYTEN4 color;
+		DirectX::PackedVector::XMUSHORTN2 uv;
 	};
 
+	static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match the attribute layout in VertexBuffer::setup");
+
+	// a quad submitted to the renderer. its vertices are already transformed
+	// and stored in the renderer's staging array at vertexOffset
 	struct Quad
 	{
-		int zIndex;
-		int sprite;
 		int texture;
-		Vertex vertices[4];
-		DirectX::XMMATRIX matrix;
-
-		Quad() : zIndex{ 0 }, sprite{ 0 }, texture{ 0 }
-		{
-
-		}
-
-		Quad(const std::array<Vertex, 4>& v, const DirectX::XMMATRIX& m, int tex, int z = 0)
-		{
-			sprite = 0;
-			for (int i = 0; i < 4; ++i)
-			{
-				vertices[i].position = v[i].position;
-				vertices[i].color = v[i].color;
-				vertices[i].uv = v[i].uv;
-			}
-
-			matrix = m;
-			texture = tex;
-			zIndex = z;
-		}
+		int vertexOffset;
 	};
 }
\ No newline at end of file
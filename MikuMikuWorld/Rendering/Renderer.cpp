@@ -9,7 +9,9 @@ namespace MikuMikuWorld
 	{
 		vBuffer.setup();
 		vBuffer.bind();
-		quads.reserve(maxQuads);
+		for (auto& layer : layers)
+			layer.reserve(maxQuads);
+		vertices.reserve(maxQuads * 4);
 		init();
 	}
 
@@ -62,10 +64,10 @@ namespace MikuMikuWorld
 
 	void Renderer::setUVCoords(const Texture& tex, float x1, float x2, float y1, float y2)
 	{
-		float left		= x1 / tex.getWidth();
-		float right		= x2 / tex.getWidth();
-		float top		= y1 / tex.getHeight();
-		float bottom	= y2 / tex.getHeight();
+		float left		= tex.getU(x1);
+		float right		= tex.getU(x2);
+		float top		= tex.getV(y1);
+		float bottom	= tex.getV(y2);
 
 		uvCoords[0] = DirectX::XMVECTOR{ right, top, 0.0f, 0.0f };
 		uvCoords[1] = DirectX::XMVECTOR{ right, bottom, 0.0f, 0.0f };
@@ -111,7 +113,7 @@ namespace MikuMikuWorld
 		vPos[3] = DirectX::XMVECTOR{ p3.x, p3.y, 0.0f, 1.0f };
 		DirectX::XMVECTOR color{ tint.r, tint.g, tint.b, tint.a };
 
-		pushQuad(vPos, uvCoords, DirectX::XMMatrixIdentity(), color, tex.getID(), z);
+		pushQuad(vPos, uvCoords, color, tex.getID(), z);
 	}
 
 	void Renderer::drawRectangle(Vector2 position, Vector2 size, const Texture& tex, float x1, float x2, float y1, float y2, Color tint, int z)
@@ -127,19 +129,28 @@ namespace MikuMikuWorld
 	void Renderer::pushQuad(const std::array<DirectX::XMVECTOR, 4>& pos, const std::array<DirectX::XMVECTOR, 4>& uv,
 		const DirectX::XMMATRIX& m, const DirectX::XMVECTOR& col, int tex, int z)
 	{
-		Quad q;
-		q.matrix = m;
-		q.texture = tex;
-		q.zIndex = z;
+		std::array<DirectX::XMVECTOR, 4> transformed;
+		for (int i = 0; i < 4; ++i)
+			transformed[i] = DirectX::XMVector2Transform(pos[i], m);
+
+		pushQuad(transformed, uv, col, tex, z);
+	}
+
+	void Renderer::pushQuad(const std::array<DirectX::XMVECTOR, 4>& pos, const std::array<DirectX::XMVECTOR, 4>& uv,
+		const DirectX::XMVECTOR& col, int tex, int z)
+	{
+		DirectX::PackedVector::XMUBYTEN4 packedColor;
+		DirectX::PackedVector::XMStoreUByteN4(&packedColor, col);
+
+		layers[std::clamp(z, 0, maxRenderLayers - 1)].push_back({ tex, (int)vertices.size() });
 		for (int i = 0; i < 4; ++i)
 		{
-			q.vertices[i].position = pos[i];
-			q.vertices[i].color = col;
-			q.vertices[i].uv = uvCoords[i];
+			PackedVertex& vertex = vertices.emplace_back();
+			DirectX::XMStoreFloat2(&vertex.position, pos[i]);
+			vertex.color = packedColor;
+			DirectX::PackedVector::XMStoreUShortN2(&vertex.uv, uv[i]);
 		}
 
-		quads.push_back(q);
-
 		++numQuads;
 		numVertices += 4;
 		numIndices += 6;
@@ -162,44 +173,127 @@ namespace MikuMikuWorld
 	{	
 		batchStarted = true;
 		vBuffer.resetBufferPos();
-		quads.clear();
+		for (auto& layer : layers)
+			layer.clear();
+
+		vertices.clear();
 		resetRenderStats();
 	}
 
+	void Renderer::flush()
+	{
+		vBuffer.uploadBuffer();
+		vBuffer.flushBuffer();
+		vBuffer.resetBufferPos();
+		++batchStats.drawCalls;
+	}
+
 	void Renderer::endBatch()
 	{
 		numBatchVertices = numVertices;
 		numBatchQuads = numQuads;
 
 		batchStarted = false;
-		if (!quads.size())
+		batchStats = RenderStats{};
+		batchStats.quads = numQuads;
+		if (!numQuads)
 			return;
 
-		std::stable_sort(quads.begin(), quads.end(),
-			[](const Quad& q1, const Quad& q2) {return q1.zIndex < q2.zIndex; });
-		
-		bindTexture(quads[0].texture);
+		// quads are appended to the layer of their z index so they are already in draw order
 		int vertexCount = 0;
+		texID = -1;
+		vBuffer.bind();
+		for (const auto& layer : layers)
+		{
+			if (layer.empty())
+				continue;
+
+			++batchStats.layers;
+			for (const auto& q : layer)
+			{
+				if (texID != q.texture || vertexCount + 4 >= vBuffer.getCapacity())
+				{
+					if (vertexCount)
+						flush();
+
+					vertexCount = 0;
+					if (texID != q.texture)
+					{
+						bindTexture(q.texture);
+						++batchStats.textureSwitches;
+					}
+				}
+
+				vBuffer.pushBuffer(vertices.data() + q.vertexOffset);
+				vertexCount += 4;
+			}
+		}
+
+		flush();
+	}
+
+	void Renderer::endBatch(RetainedGeometry& geometry)
+	{
+		numBatchVertices = numVertices;
+		numBatchQuads = numQuads;
+
+		batchStarted = false;
+		batchStats = RenderStats{};
+		batchStats.quads = numQuads;
+
+		geometry.ranges.clear();
+		if (!numQuads)
+			return;
+
+		// the buffer is refilled in place and only replaced when the quads no longer fit.
+		// it is given some room to grow so a chunk gaining a few notes does not reallocate it
+		if (!geometry.buffer || geometry.buffer->getCapacity() < numQuads * 4)
+		{
+			geometry.buffer = std::make_unique<VertexBuffer>((numQuads + numQuads / 2) * 4);
+			geometry.buffer->setup();
+		}
+
+		geometry.buffer->resetBufferPos();
+		geometry.buffer->bind();
 
-		for (const auto& q : quads)
+		int firstVertex = 0;
+		for (int l = 0; l < maxRenderLayers; ++l)
 		{
-			if (texID != q.texture || vertexCount + 4 >= vBuffer.getCapacity())
+			for (const auto& q : layers[l])
 			{
-				vBuffer.uploadBuffer();
-				vBuffer.flushBuffer();
-				vBuffer.resetBufferPos();
-				vertexCount = 0;
+				if (geometry.ranges.empty() || geometry.ranges.back().layer != l || geometry.ranges.back().texture != q.texture)
+					geometry.ranges.push_back({ l, q.texture, firstVertex, 0 });
 
-				bindTexture(q.texture);
+				geometry.buffer->pushBuffer(vertices.data() + q.vertexOffset);
+				geometry.ranges.back().vertexCount += 4;
+				firstVertex += 4;
 			}
-
-			vBuffer.pushBuffer(q);
-			vertexCount += 4;
 		}
 
-		vBuffer.uploadBuffer();
-		vBuffer.flushBuffer();
+		geometry.buffer->uploadBuffer();
+	}
 
-		batchStarted = false;
+	void Renderer::drawRetained(const RetainedGeometry& geometry, int layer)
+	{
+		// texID is not trusted here since anything may have bound another texture since the last batch
+		bool bound = false;
+		for (const auto& range : geometry.ranges)
+		{
+			if (range.layer != layer)
+				continue;
+
+			if (!bound)
+			{
+				geometry.buffer->bind();
+				bound = true;
+			}
+
+			bindTexture(range.texture);
+			geometry.buffer->flushBuffer(range.firstVertex, range.vertexCount);
+
+			retainedStats.quads += range.vertexCount / 4;
+			++retainedStats.textureSwitches;
+			++retainedStats.drawCalls;
+		}
 	}
 }
\ No newline at end of file
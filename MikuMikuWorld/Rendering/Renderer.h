@@ -6,11 +6,39 @@
 #include "VertexBuffer.h"
 #include <vector>
 #include <array>
+#include <memory>
 
 namespace MikuMikuWorld
 {
 	constexpr size_t maxQuads = 1500;
 
+	// z indices are clamped to this many layers, drawn from lowest to highest
+	constexpr int maxRenderLayers = 4;
+
+	struct RenderStats
+	{
+		int quads{};
+		int layers{};
+		int textureSwitches{};
+		int drawCalls{};
+	};
+
+	// quads kept in their own vertex buffer so they can be drawn again without being resubmitted.
+	// positions are whatever the batch was recorded with, so moving them is left to the view matrix
+	struct RetainedGeometry
+	{
+		struct Range
+		{
+			int layer;
+			int texture;
+			int firstVertex;
+			int vertexCount;
+		};
+
+		std::unique_ptr<VertexBuffer> buffer;
+		std::vector<Range> ranges;
+	};
+
 	class Renderer
 	{
 	private:
@@ -21,16 +49,22 @@ namespace MikuMikuWorld
 		size_t numBatchQuads;
 
 		VertexBuffer vBuffer;
-		std::vector<Quad> quads;
+		std::array<std::vector<Quad>, maxRenderLayers> layers;
+		std::vector<PackedVertex> vertices;
 		std::array<DirectX::XMVECTOR, 4> vPos;
 		std::array<DirectX::XMVECTOR, 4> uvCoords;
 
 		unsigned int vao, vbo, ebo;
 		int texID;
 		bool batchStarted;
+		RenderStats batchStats;
+
+		// retained draws accumulate here until reset, since they happen outside of any batch
+		RenderStats retainedStats;
 
 		void init();
 		void resetRenderStats();
+		void flush();
 
 	public:
 		Renderer();
@@ -51,11 +85,28 @@ namespace MikuMikuWorld
 		void pushQuad(const std::array<DirectX::XMVECTOR, 4>& pos, const std::array<DirectX::XMVECTOR, 4>& uv,
 			const DirectX::XMMATRIX& m, const DirectX::XMVECTOR& col, int tex, int z);
 
+		// positions are taken as they are, without a model transform
+		void pushQuad(const std::array<DirectX::XMVECTOR, 4>& pos, const std::array<DirectX::XMVECTOR, 4>& uv,
+			const DirectX::XMVECTOR& col, int tex, int z);
+
 		void bindTexture(int tex);
 		void beginBatch();
 		void endBatch();
 
+		/// <summary>
+		/// Ends the batch by moving its quads into the geometry's own vertex buffer instead of drawing them
+		/// </summary>
+		void endBatch(RetainedGeometry& geometry);
+
+		/// <summary>
+		/// Draws the quads of one z layer of a retained batch
+		/// </summary>
+		void drawRetained(const RetainedGeometry& geometry, int layer);
+
 		inline int getNumVertices() const { return numBatchVertices; }
 		inline int getNumQuads() const { return numBatchQuads; }
+		inline const RenderStats& getBatchStats() const { return batchStats; }
+		inline const RenderStats& getRetainedStats() const { return retainedStats; }
+		inline void resetRetainedStats() { retainedStats = RenderStats{}; }
 	};
 }
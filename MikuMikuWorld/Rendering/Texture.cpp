@@ -16,16 +16,28 @@ namespace MikuMikuWorld
 		this->filename = filename;
 		name = File::getFilenameWithoutExtension(filename);
 		read(filename);
+		loadSprites();
+	}
 
-		std::string sprSheet = File::getFilepath(filename) + "spr/" + name + ".txt";
-		if (File::exists(sprSheet))
-		{
-			readSprites(sprSheet);
-		}
-		else
-		{
-			sprites.push_back(Sprite(name, 0, 0, width, height));
-		}
+	Texture::Texture(const std::string& _name, const uint8_t* data, int _width, int _height, int padding) :
+		name{ _name }, width{ _width }, height{ _height }, atlasWidth{ _width }, atlasHeight{ _height }
+	{
+		// each mip level halves the padding, so stop at the last level where
+		// it still covers a whole texel to keep neighbouring images from bleeding in
+		int maxLevel = 0;
+		while ((padding >> (maxLevel + 1)) > 0)
+			++maxLevel;
+
+		upload(data, GL_CLAMP_TO_EDGE, maxLevel);
+		sprites.push_back(Sprite(name, 0, 0, width, height));
+	}
+
+	Texture::Texture(const std::string& _filename, const Texture& atlas, int x, int y, int _width, int _height) :
+		filename{ _filename }, width{ _width }, height{ _height }, glID{ atlas.glID },
+		atlasX{ x }, atlasY{ y }, atlasWidth{ atlas.width }, atlasHeight{ atlas.height }
+	{
+		name = File::getFilenameWithoutExtension(filename);
+		loadSprites();
 	}
 
 	Texture::Texture()
@@ -43,6 +55,19 @@ namespace MikuMikuWorld
 		glDeleteTextures(1, &glID);
 	}
 
+	void Texture::loadSprites()
+	{
+		std::string sprSheet = File::getFilepath(filename) + "spr/" + name + ".txt";
+		if (File::exists(sprSheet))
+		{
+			readSprites(sprSheet);
+		}
+		else
+		{
+			sprites.push_back(Sprite(name, 0, 0, width, height));
+		}
+	}
+
 	void Texture::readSprites(const std::string& filename)
 	{
 		std::wstring wFilename = mbToWideStr(filename);
@@ -71,21 +96,31 @@ namespace MikuMikuWorld
 
 	void Texture::read(const std::string& filename)
 	{
-		glGenTextures(1, &glID);
-		glBindTexture(GL_TEXTURE_2D, glID);
-
 		int nrChannels;
 		stbi_set_flip_vertically_on_load(0);
 		auto data = stbi_load(filename.c_str(), &width, &height, &nrChannels, 4);
 
+		atlasX = atlasY = 0;
+		atlasWidth = width;
+		atlasHeight = height;
+		// standalone textures keep the full mip chain (1000 is GL's default max level)
+		upload(data, GL_REPEAT, 1000);
+		free(data);
+	}
+
+	void Texture::upload(const uint8_t* data, int wrap, int maxLevel)
+	{
+		glGenTextures(1, &glID);
+		glBindTexture(GL_TEXTURE_2D, glID);
+
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
 		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 		glBindTexture(GL_TEXTURE_2D, 0);
-		free(data);
 	}
 }
\ No newline at end of file
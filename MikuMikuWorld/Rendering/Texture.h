@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "Sprite.h"
@@ -21,12 +22,31 @@ namespace MikuMikuWorld
 		int height;
 		unsigned int glID;
 
+		// position of the image in its GL texture and the size of that texture,
+		// which is shared with other images when they are packed into an atlas
+		int atlasX{};
+		int atlasY{};
+		int atlasWidth{ 1 };
+		int atlasHeight{ 1 };
+
 		Sprite parseSprite(const IO::File &f, const std::string& line);
+		void loadSprites();
+		void upload(const uint8_t* data, int wrap, int maxLevel);
 
 	public:
 		std::vector<Sprite> sprites;
 
 		Texture(const std::string& filename);
+
+		/// <summary>
+		/// Creates an atlas page from RGBA pixels whose images are separated by the specified padding
+		/// </summary>
+		Texture(const std::string& _name, const uint8_t* data, int _width, int _height, int padding);
+
+		/// <summary>
+		/// Creates a texture for an image packed into an atlas page at the specified position
+		/// </summary>
+		Texture(const std::string& _filename, const Texture& atlas, int x, int y, int _width, int _height);
 		Texture();
 
 		inline int getWidth() const { return width; }
@@ -35,6 +55,10 @@ namespace MikuMikuWorld
 		inline const std::string& getName() const { return name; }
 		inline const std::string& getFilename() const { return filename; }
 
+		// maps pixel coordinates of the image to texture coordinates of its GL texture
+		inline float getU(float x) const { return (atlasX + x) / atlasWidth; }
+		inline float getV(float y) const { return (atlasY + y) / atlasHeight; }
+
 		void bind() const;
 		void dispose();
 		void read(const std::string& filename);
@@ -0,0 +1,95 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace MikuMikuWorld
+{
+	AtlasPacker::AtlasPacker(int _maxSize, int _padding) : maxSize{ _maxSize }, padding{ _padding }
+	{
+
+	}
+
+	std::vector<AtlasPage> AtlasPacker::pack(std::vector<AtlasRegion>& regions) const
+	{
+		// tallest first so each row is only as high as the first region placed in it
+		std::vector<size_t> order(regions.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&regions](size_t a, size_t b)
+		{
+			return regions[a].height > regions[b].height;
+		});
+
+		std::vector<AtlasPage> pages;
+		std::vector<Row> rows;
+		for (size_t index : order)
+		{
+			AtlasRegion& region = regions[index];
+			int cellWidth = region.width + padding * 2;
+			int cellHeight = region.height + padding * 2;
+			if (cellWidth > maxSize || cellHeight > maxSize)
+				throw std::runtime_error("Image of size " + std::to_string(region.width) + "x" + std::to_string(region.height) + " does not fit in the atlas");
+
+			auto row = std::find_if(rows.begin(), rows.end(), [&](const Row& r)
+			{
+				return r.height >= cellHeight && r.width + cellWidth <= maxSize;
+			});
+
+			if (row == rows.end())
+			{
+				int page = -1;
+				int y = 0;
+				for (int p = 0; p < pages.size(); ++p)
+				{
+					if (pages[p].height + cellHeight <= maxSize)
+					{
+						page = p;
+						y = pages[p].height;
+						break;
+					}
+				}
+
+				if (page == -1)
+				{
+					page = pages.size();
+					pages.push_back({});
+				}
+
+				pages[page].height = y + cellHeight;
+				rows.push_back({ page, y, cellHeight, 0 });
+				row = rows.end() - 1;
+			}
+
+			region.page = row->page;
+			region.x = row->width + padding;
+			region.y = row->y + padding;
+			row->width += cellWidth;
+			pages[row->page].width = std::max(pages[row->page].width, row->width);
+		}
+
+		return pages;
+	}
+
+	void blitAtlasRegion(std::vector<uint8_t>& pixels, const AtlasPage& page, const AtlasRegion& region, const uint8_t* image, int padding)
+	{
+		constexpr int channels = 4;
+		if (!region.width || !region.height)
+			return;
+
+		for (int y = -padding; y < region.height + padding; ++y)
+		{
+			int sourceY = std::clamp(y, 0, region.height - 1);
+			const uint8_t* source = image + (size_t)sourceY * region.width * channels;
+			uint8_t* destination = pixels.data() + ((size_t)(region.y + y) * page.width + region.x) * channels;
+
+			std::memcpy(destination, source, (size_t)region.width * channels);
+			for (int x = 1; x <= padding; ++x)
+			{
+				std::memcpy(destination - x * channels, source, channels);
+				std::memcpy(destination + (region.width + x - 1) * channels, source + (region.width - 1) * channels, channels);
+			}
+		}
+	}
+}
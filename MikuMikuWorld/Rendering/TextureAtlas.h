@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace MikuMikuWorld
+{
+	struct AtlasRegion
+	{
+		int width{};
+		int height{};
+
+		// set by AtlasPacker::pack
+		int x{};
+		int y{};
+		int page{ -1 };
+	};
+
+	struct AtlasPage
+	{
+		int width{};
+		int height{};
+	};
+
+	// places images on as few pages as possible using rows of decreasing height.
+	// every region keeps padding pixels of free space on each side, inside the page
+	class AtlasPacker
+	{
+	private:
+		struct Row
+		{
+			int page;
+			int y;
+			int height;
+			int width;
+		};
+
+		int maxSize;
+		int padding;
+
+	public:
+		AtlasPacker(int _maxSize, int _padding);
+
+		/// <summary>
+		/// Assigns a page and position to every region and returns the size of each page.
+		/// throws if a region does not fit on an empty page
+		/// </summary>
+		std::vector<AtlasPage> pack(std::vector<AtlasRegion>& regions) const;
+	};
+
+	/// <summary>
+	/// Copies an RGBA image into a page at the region's position and extends its
+	/// edge pixels into the padding so filtering does not pick up its neighbours
+	/// </summary>
+	void blitAtlasRegion(std::vector<uint8_t>& pixels, const AtlasPage& page, const AtlasRegion& region, const uint8_t* image, int padding);
+}
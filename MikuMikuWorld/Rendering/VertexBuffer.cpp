@@ -1,11 +1,13 @@
 #include "VertexBuffer.h"
 #include "glad/glad.h"
 #include <cstddef>
+#include <cstring>
 
 namespace MikuMikuWorld
 {
+	// the capacity is kept to whole quads since setup writes the indices of one quad at a time
 	VertexBuffer::VertexBuffer(int _capacity) :
-		vertexCapcity{ _capacity }, bufferPos{ 0 }, vao{ 0 }, vbo{ 0 }, ebo{ 0 }
+		vertexCapcity{ _capacity - _capacity % 4 }, bufferPos{ 0 }, vao{ 0 }, vbo{ 0 }, ebo{ 0 }
 	{
 		buffer = nullptr;
 		indices = nullptr;
@@ -19,7 +21,7 @@ namespace MikuMikuWorld
 
 	void VertexBuffer::setup()
 	{
-		buffer = new Vertex[vertexCapcity];
+		buffer = new PackedVertex[vertexCapcity];
 		indices = new int[indexCapacity];
 
 		size_t offset = 0;
@@ -43,19 +45,19 @@ namespace MikuMikuWorld
 		glGenBuffers(1, &ebo);
 
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, vertexCapcity * sizeof(Vertex), NULL, GL_DYNAMIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, vertexCapcity * sizeof(PackedVertex), NULL, GL_DYNAMIC_DRAW);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 
 		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
 
 		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, color));
 
 		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+		glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, uv));
 
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindVertexArray(0);
@@ -79,7 +81,7 @@ namespace MikuMikuWorld
 
 	int VertexBuffer::getSize() const
 	{
-		return bufferPos * sizeof(Vertex);
+		return bufferPos * sizeof(PackedVertex);
 	}
 
 	int VertexBuffer::getCapacity() const
@@ -87,15 +89,9 @@ namespace MikuMikuWorld
 		return vertexCapcity;
 	}
 
-	void VertexBuffer::pushBuffer(const Quad& q)
+	void VertexBuffer::pushBuffer(const PackedVertex* vertices)
 	{
-		for (int offset = 0; offset < 4; ++offset)
-		{
-			buffer[bufferPos + offset].position = DirectX::XMVector2Transform(q.vertices[offset].position, q.matrix);
-			buffer[bufferPos + offset].color = q.vertices[offset].color;
-			buffer[bufferPos + offset].uv = q.vertices[offset].uv;
-		}
-
+		std::memcpy(buffer + bufferPos, vertices, sizeof(PackedVertex) * 4);
 		bufferPos += 4;
 	}
 
@@ -115,4 +111,11 @@ namespace MikuMikuWorld
 		size_t numIndices = (bufferPos / 4) * 6;
 		glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
 	}
+
+	void VertexBuffer::flushBuffer(int firstVertex, int vertexCount)
+	{
+		size_t firstIndex = (firstVertex / 4) * 6;
+		size_t numIndices = (vertexCount / 4) * 6;
+		glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(unsigned int)));
+	}
 }
\ No newline at end of file
@@ -6,7 +6,7 @@ namespace MikuMikuWorld
 	class VertexBuffer
 	{
 	private:
-		Vertex* buffer;
+		PackedVertex* buffer;
 		int* indices;
 		int indexCapacity;
 		int vertexCapcity;
@@ -23,10 +23,11 @@ namespace MikuMikuWorld
 		void setup();
 		void dispose();
 		void bind() const;
-		void pushBuffer(const Quad& q);
+		void pushBuffer(const PackedVertex* vertices);
 		void resetBufferPos();
 		void uploadBuffer();
 		void flushBuffer();
+		void flushBuffer(int firstVertex, int vertexCount);
 		int getCapacity() const;
 		int getSize() const;
 	};
@@ -1,5 +1,9 @@
 #include "ResourceManager.h"
 #include "IO.h"
+#include "Rendering/TextureAtlas.h"
+#include <glad/glad.h>
+#include "stb_image.h"
+#include <algorithm>
 #include <filesystem>
 
 namespace MikuMikuWorld
@@ -7,6 +11,9 @@ namespace MikuMikuWorld
 	std::vector<Texture> ResourceManager::textures;
 	std::vector<Shader*> ResourceManager::shaders;
 
+	constexpr int atlasPadding = 8;
+	constexpr int maxAtlasSize = 4096;
+
 	void ResourceManager::loadTexture(const std::string filename)
 	{
 		if (!IO::File::exists(filename))
@@ -25,6 +32,74 @@ namespace MikuMikuWorld
 		textures.push_back(tex);
 	}
 
+	void ResourceManager::loadTextureAtlas(const std::string& name, const std::vector<std::string>& filenames)
+	{
+		std::vector<std::string> loadedFilenames;
+		std::vector<uint8_t*> images;
+		std::vector<AtlasRegion> regions;
+		for (const auto& filename : filenames)
+		{
+			if (getTextureByFilename(filename) != -1)
+				continue;
+
+			if (!IO::File::exists(filename))
+			{
+				printf("ERROR: ResourceManager::loadTextureAtlas() Could not find texture file %s\n", filename.c_str());
+				continue;
+			}
+
+			AtlasRegion region;
+			int nrChannels;
+			stbi_set_flip_vertically_on_load(0);
+			uint8_t* data = stbi_load(filename.c_str(), &region.width, &region.height, &nrChannels, 4);
+			if (!data)
+				continue;
+
+			loadedFilenames.push_back(filename);
+			images.push_back(data);
+			regions.push_back(region);
+		}
+
+		int maxTextureSize = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+
+		try
+		{
+			AtlasPacker packer(std::min(maxTextureSize, maxAtlasSize), atlasPadding);
+			std::vector<AtlasPage> pages = packer.pack(regions);
+
+			std::vector<int> pageTextures;
+			for (int p = 0; p < pages.size(); ++p)
+			{
+				std::vector<uint8_t> pixels((size_t)pages[p].width * pages[p].height * 4);
+				for (int i = 0; i < regions.size(); ++i)
+				{
+					if (regions[i].page == p)
+						blitAtlasRegion(pixels, pages[p], regions[i], images[i], atlasPadding);
+				}
+
+				pageTextures.push_back(textures.size());
+				textures.push_back(Texture(name + "_" + std::to_string(p), pixels.data(), pages[p].width, pages[p].height, atlasPadding));
+			}
+
+			for (int i = 0; i < regions.size(); ++i)
+			{
+				const Texture& atlas = textures[pageTextures[regions[i].page]];
+				textures.push_back(Texture(loadedFilenames[i], atlas, regions[i].x, regions[i].y, regions[i].width, regions[i].height));
+			}
+		}
+		catch (std::exception& ex)
+		{
+			// images that cannot be packed are still usable as separate textures
+			printf("ERROR: ResourceManager::loadTextureAtlas() %s\n", ex.what());
+			for (const auto& filename : loadedFilenames)
+				loadTexture(filename);
+		}
+
+		for (uint8_t* data : images)
+			stbi_image_free(data);
+	}
+
 	int ResourceManager::getTexture(const std::string& name)
 	{
 		for (int i = 0; i < textures.size(); ++i)
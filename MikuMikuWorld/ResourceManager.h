@@ -12,6 +12,12 @@ namespace MikuMikuWorld
 		static std::vector<Shader*> shaders;
 
 		static void loadTexture(const std::string filename);
+
+		/// <summary>
+		/// Loads the images into as few GL textures as possible. each image is still
+		/// added as a texture of its own name whose coordinates map into the atlas
+		/// </summary>
+		static void loadTextureAtlas(const std::string& name, const std::vector<std::string>& filenames);
 		static int getTexture(const std::string& name);
 		static int getTextureByFilename(const std::string& filename);
 
@@ -23,6 +23,8 @@ namespace MikuMikuWorld
 	{
 		int measure;
 		int ticksPerMeasure;
+
+		// tick the bar's first measure starts at
 		int ticks;
 	};
 
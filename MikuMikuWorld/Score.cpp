@@ -4,7 +4,9 @@
 #include "BinaryWriter.h"
 #include "IO.h"
 #include "Constants.h"
+#include "EditJournal.h"
 #include <unordered_set>
+#include <algorithm>
 
 using namespace IO;
 
@@ -23,6 +25,63 @@ namespace MikuMikuWorld
 		fever.startTick = fever.endTick = -1;
 	}
 
+	void Score::rebuildNoteIndex() const
+	{
+		auto index = std::make_shared<std::vector<NoteIndexEntry>>();
+		index->reserve(notes.size());
+		for (int slot = 0; slot < notes.slotCount(); ++slot)
+		{
+			if (notes.isUsed(slot))
+				index->push_back({ notes.getTick(slot), notes.getLane(slot), notes.getID(slot) });
+		}
+
+		std::sort(index->begin(), index->end(), [](const NoteIndexEntry& a, const NoteIndexEntry& b)
+		{
+			if (a.tick != b.tick) return a.tick < b.tick;
+			if (a.lane != b.lane) return a.lane < b.lane;
+			return a.ID < b.ID;
+		});
+
+		noteIndex = std::move(index);
+		noteIndexDirty = false;
+	}
+
+	NoteRange Score::notesInTickRange(int first, int last) const
+	{
+		if (noteIndexDirty)
+			rebuildNoteIndex();
+
+		auto begin = std::lower_bound(noteIndex->begin(), noteIndex->end(), first,
+			[](const NoteIndexEntry& entry, int tick) { return entry.tick < tick; });
+
+		auto end = std::upper_bound(begin, noteIndex->end(), last,
+			[](int tick, const NoteIndexEntry& entry) { return tick < entry.tick; });
+
+		return NoteRange{ begin, end };
+	}
+
+	const TempoMap& Score::getTempoMap() const
+	{
+		if (tempoMapDirty)
+		{
+			tempoMap.rebuild(tempoChanges, TICKS_PER_BEAT);
+			tempoMapDirty = false;
+		}
+
+		return tempoMap;
+	}
+
+	const MeasureMap& Score::getMeasureMap() const
+	{
+		if (measureMapDirty)
+		{
+			measureMap.rebuild(timeSignatures, TICKS_PER_BEAT);
+			measureMapDirty = false;
+		}
+
+		return measureMap;
+	}
+
 	Note readNote(NoteType type, BinaryReader* reader)
 	{
 		Note note(type);
@@ -162,43 +221,107 @@ namespace MikuMikuWorld
 		writer->writeInt32(score.fever.endTick);
 	}
 
-	Score deserializeScore(const std::string& filename)
+	enum class MmwsSection : uint32_t
 	{
-		Score score;
-		BinaryReader reader(filename);
-		if (!reader.isStreamValid())
-			return score;
+		Metadata,
+		Events,
+		Taps,
+		Holds,
+		SectionTypeCount
+	};
+
+	struct MmwsHeader
+	{
+		int version{};
+		int tapCount{ -1 };
+		int holdCount{ -1 };
+
+		// only set for version 3 and up
+		uint32_t addresses[(int)MmwsSection::SectionTypeCount]{};
+		uint32_t lengths[(int)MmwsSection::SectionTypeCount]{};
+	};
 
-		std::string signature = reader.readString();
+	MmwsHeader readHeader(BinaryReader* reader)
+	{
+		std::string signature = reader->readString();
 		if (signature != "MMWS")
 			throw std::runtime_error("Not a MMWS file.");
 
-		int version = reader.readInt32();
+		MmwsHeader header;
+		header.version = reader->readInt32();
+		if (header.version > MMWS_VERSION)
+			throw std::runtime_error("Unsupported MMWS version " + std::to_string(header.version) + ".");
 
-		uint32_t metadataAddress = 0;
-		uint32_t eventsAddress = 0;
-		uint32_t tapsAddress = 0;
-		uint32_t holdsAddress = 0;
-		if (version > 2)
+		if (header.version == 3)
 		{
-			metadataAddress = reader.readInt32();
-			eventsAddress = reader.readInt32();
-			tapsAddress = reader.readInt32();
-			holdsAddress = reader.readInt32();
+			for (int i = 0; i < (int)MmwsSection::SectionTypeCount; ++i)
+				header.addresses[i] = reader->readInt32();
+		}
+		else if (header.version > 3)
+		{
+			header.tapCount = reader->readInt32();
+			header.holdCount = reader->readInt32();
+
+			bool found[(int)MmwsSection::SectionTypeCount]{};
+			int sectionCount = reader->readInt32();
+			for (int i = 0; i < sectionCount; ++i)
+			{
+				uint32_t type = reader->readInt32();
+				uint32_t address = reader->readInt32();
+				uint32_t length = reader->readInt32();
+
+				// sections added by newer versions are skipped
+				if (type >= (uint32_t)MmwsSection::SectionTypeCount)
+					continue;
+
+				header.addresses[type] = address;
+				header.lengths[type] = length;
+				found[type] = true;
+			}
 
-			reader.seek(metadataAddress);
+			for (int i = 0; i < (int)MmwsSection::SectionTypeCount; ++i)
+			{
+				if (!found[i])
+					throw std::runtime_error("Missing section " + std::to_string(i) + " in MMWS file.");
+			}
 		}
 
-		score.metadata = readMetadata(&reader, version);
+		return header;
+	}
 
-		if (version > 2)
-			reader.seek(eventsAddress);
+	void seekSection(BinaryReader* reader, const MmwsHeader& header, MmwsSection section)
+	{
+		if (header.version < 3)
+			return;
 
-		readScoreEvents(score, version, &reader);
+		const int index = (int)section;
+		if (header.version > 3 && (size_t)header.addresses[index] + header.lengths[index] > reader->getFileSize())
+			throw std::runtime_error("Section " + std::to_string(index) + " extends past the end of the file.");
 
-		if (version > 2)
-			reader.seek(tapsAddress);
+		reader->seek(header.addresses[index]);
+	}
+
+	Score deserializeScore(const std::string& filename, EditJournal* journal)
+	{
+		Score score;
+		BinaryReader reader(filename);
+		if (!reader.isStreamValid())
+			throw std::runtime_error("Could not open " + filename + ".");
+
+		MmwsLayout layout;
+		layout.fileSize = reader.getFileSize();
+		layout.checksum = fnv1a(reader.getData().data(), layout.fileSize);
+
+		MmwsHeader header = readHeader(&reader);
+		const int version = header.version;
+
+		seekSection(&reader, header, MmwsSection::Metadata);
+		score.metadata = readMetadata(&reader, version);
+
+		seekSection(&reader, header, MmwsSection::Events);
+		readScoreEvents(score, version, &reader);
 
+		seekSection(&reader, header, MmwsSection::Taps);
 		int noteCount = reader.readInt32();
 		score.notes.reserve(noteCount);
 		for (int i = 0; i < noteCount; ++i)
@@ -206,11 +329,10 @@ namespace MikuMikuWorld
 			Note note = readNote(NoteType::Tap, &reader);
 			note.ID = nextID++;
 			score.notes[note.ID] = note;
+			layout.noteIDs.push_back(note.ID);
 		}
 
-		if (version > 2)
-			reader.seek(holdsAddress);
-
+		seekSection(&reader, header, MmwsSection::Holds);
 		int holdCount = reader.readInt32();
 		score.holdNotes.reserve(holdCount);
 		for (int i = 0; i < holdCount; ++i)
@@ -222,6 +344,7 @@ namespace MikuMikuWorld
 			hold.start.ease = (EaseType)reader.readInt32();
 			hold.start.ID = start.ID;
 			score.notes[start.ID] = start;
+			layout.noteIDs.push_back(start.ID);
 
 			int stepCount = reader.readInt32();
 			hold.steps.reserve(stepCount);
@@ -231,6 +354,7 @@ namespace MikuMikuWorld
 				mid.ID = nextID++;
 				mid.parentID = start.ID;
 				score.notes[mid.ID] = mid;
+				layout.noteIDs.push_back(mid.ID);
 
 				HoldStep step;
 				step.type = (HoldStepType)reader.readInt32();
@@ -243,57 +367,129 @@ namespace MikuMikuWorld
 			end.ID = nextID++;
 			end.parentID = start.ID;
 			score.notes[end.ID] = end;
+			layout.noteIDs.push_back(end.ID);
 			
 			hold.end = end.ID;
 			score.holdNotes[start.ID] = hold;
 		}
 
 		reader.close();
+
+		EditJournal replayJournal;
+		(journal ? *journal : replayJournal).load(filename, layout, score);
+
 		return score;
 	}
 
-	void serializeScore(const Score& score, const std::string& filename)
+	ScoreInfo readScoreInfo(const std::string& filename)
+	{
+		// enough for the header of any version and the metadata of most version 4 files
+		constexpr size_t prefixSize = 4096;
+
+		BinaryReader prefix(filename, prefixSize);
+		if (!prefix.isStreamValid())
+			throw std::runtime_error("Could not open " + filename + ".");
+
+		MmwsHeader header = readHeader(&prefix);
+
+		ScoreInfo info;
+		info.version = header.version;
+
+		if (header.version > 3)
+		{
+			const int index = (int)MmwsSection::Metadata;
+			const size_t metadataEnd = (size_t)header.addresses[index] + header.lengths[index];
+
+			BinaryReader reader = metadataEnd > prefix.getFileSize() ? BinaryReader(filename, metadataEnd) : std::move(prefix);
+			seekSection(&reader, header, MmwsSection::Metadata);
+			info.metadata = readMetadata(&reader, header.version);
+			info.tapCount = header.tapCount;
+			info.holdCount = header.holdCount;
+
+			return info;
+		}
+
+		// older versions have no counts in the header so they are read from the start of the note sections
+		BinaryReader reader(filename);
+		if (!reader.isStreamValid())
+			throw std::runtime_error("Could not open " + filename + ".");
+
+		readHeader(&reader);
+		info.metadata = readMetadata(&reader, header.version);
+
+		if (header.version > 2)
+		{
+			seekSection(&reader, header, MmwsSection::Taps);
+			info.tapCount = reader.readInt32();
+
+			seekSection(&reader, header, MmwsSection::Holds);
+			info.holdCount = reader.readInt32();
+		}
+		else
+		{
+			// the events are only read to skip past them, so the skill IDs they
+			// hand out are given back to keep the next loaded score's IDs unchanged
+			int skillID = nextSkillID;
+			Score events;
+			readScoreEvents(events, header.version, &reader);
+			nextSkillID = skillID;
+
+			// taps are tick, lane, width, flick and critical
+			info.tapCount = reader.readInt32();
+			reader.seek(reader.getStreamPosition() + (size_t)info.tapCount * sizeof(uint32_t) * 5);
+			info.holdCount = reader.readInt32();
+		}
+
+		return info;
+	}
+
+	void serializeScore(const Score& score, const std::string& filename, MmwsLayout* layout)
 	{
 		BinaryWriter writer(filename);
-		if (!writer.isStreamValid())
-			return;
+
+		int tapCount = 0;
+		for (int slot = 0; slot < score.notes.slotCount(); ++slot)
+		{
+			if (score.notes.isUsed(slot) && score.notes.getType(slot) == NoteType::Tap)
+				++tapCount;
+		}
 
 		// signature
 		writer.writeString("MMWS");
 
 		// verison
-		writer.writeInt32(3);
+		writer.writeInt32(MMWS_VERSION);
+
+		writer.writeInt32(tapCount);
+		writer.writeInt32(score.holdNotes.size());
 
-		// offsets address in order: metadata -> events -> taps -> holds
-		uint32_t offsetsAddress = writer.getStreamPosition();
-		writer.writeNull(sizeof(uint32_t) * 4);
+		// section table of type, address and length. filled after the sections are written
+		constexpr int sectionCount = (int)MmwsSection::SectionTypeCount;
+		writer.writeInt32(sectionCount);
+		uint32_t tableAddress = writer.getStreamPosition();
+		writer.writeNull(sizeof(uint32_t) * 3 * sectionCount);
 
-		uint32_t metadataAddress = writer.getStreamPosition();
+		uint32_t addresses[sectionCount]{};
+
+		addresses[(int)MmwsSection::Metadata] = writer.getStreamPosition();
 		writeMetadata(score.metadata, &writer);
 
-		uint32_t eventsAddress = writer.getStreamPosition();
+		addresses[(int)MmwsSection::Events] = writer.getStreamPosition();
 		writeScoreEvents(score, &writer);
 
-		uint32_t tapsAddress = writer.getStreamPosition();
-		writer.writeNull(sizeof(uint32_t));
-
-		int noteCount = 0;
+		addresses[(int)MmwsSection::Taps] = writer.getStreamPosition();
+		writer.writeInt32(tapCount);
 		for (const auto&[id, note] : score.notes)
 		{
-			if (note.getType() != NoteType::Tap)
-				continue;
-
-			writeNote(note, &writer);
-			++noteCount;
+			if (note.getType() == NoteType::Tap)
+			{
+				writeNote(note, &writer);
+				if (layout)
+					layout->noteIDs.push_back(id);
+			}
 		}
-		
-		uint32_t holdsAddress = writer.getStreamPosition();
-		
-		// write taps count
-		writer.seek(tapsAddress);
-		writer.writeInt32(noteCount);
-		writer.seek(holdsAddress);
-		
+
+		addresses[(int)MmwsSection::Holds] = writer.getStreamPosition();
 		writer.writeInt32(score.holdNotes.size());
 		for (const auto&[id, hold] : score.holdNotes)
 		{	
@@ -301,6 +497,8 @@ namespace MikuMikuWorld
 			const Note& start = score.notes.at(hold.start.ID);
 			writeNote(start, &writer);
 			writer.writeInt32((int)hold.start.ease);
+			if (layout)
+				layout->noteIDs.push_back(start.ID);
 
 			// steps
 			int stepCount = hold.steps.size();
@@ -311,21 +509,37 @@ namespace MikuMikuWorld
 				writeNote(mid, &writer);
 				writer.writeInt32((int)step.type);
 				writer.writeInt32((int)step.ease);
+				if (layout)
+					layout->noteIDs.push_back(mid.ID);
 			}
 
 			// end
 			const Note& end = score.notes.at(hold.end);
 			writeNote(end, &writer);
+			if (layout)
+				layout->noteIDs.push_back(end.ID);
+		}
+
+		uint32_t fileEnd = writer.getStreamPosition();
+
+		writer.seek(tableAddress);
+		for (int i = 0; i < sectionCount; ++i)
+		{
+			uint32_t sectionEnd = i + 1 < sectionCount ? addresses[i + 1] : fileEnd;
+			writer.writeInt32(i);
+			writer.writeInt32(addresses[i]);
+			writer.writeInt32(sectionEnd - addresses[i]);
+		}
+
+		if (layout)
+		{
+			layout->fileSize = writer.getFileSize();
+			layout->checksum = fnv1a(writer.getData().data(), layout->fileSize);
 		}
 
-		// write offset addresses
-		writer.seek(offsetsAddress);
-		writer.writeInt32(metadataAddress);
-		writer.writeInt32(eventsAddress);
-		writer.writeInt32(tapsAddress);
-		writer.writeInt32(holdsAddress);
+		if (!writer.flush())
+			throw std::runtime_error("Could not write " + filename + ".");
 
-		writer.flush();
 		writer.close();
 	}
 }
@@ -1,5 +1,7 @@
 #pragma once
 #include "Note.h"
+#include "NoteStore.h"
+#include "CowMap.h"
 #include "Tempo.h"
 #include <string>
 #include <map>
@@ -8,7 +10,9 @@
 
 namespace MikuMikuWorld
 {
-	extern int nextSkillID;
+	extern thread_local int nextSkillID;
+
+	class EditJournal;
 
 	struct SkillTrigger
 	{
@@ -38,11 +42,28 @@ namespace MikuMikuWorld
 		float musicOffset;
 	};
 
+	struct NoteIndexEntry
+	{
+		int tick;
+		int lane;
+		int ID;
+	};
+
+	struct NoteRange
+	{
+		std::vector<NoteIndexEntry>::const_iterator first;
+		std::vector<NoteIndexEntry>::const_iterator last;
+
+		inline std::vector<NoteIndexEntry>::const_iterator begin() const { return first; }
+		inline std::vector<NoteIndexEntry>::const_iterator end() const { return last; }
+		inline bool empty() const { return first == last; }
+	};
+
 	struct Score
 	{
 		ScoreMetadata metadata;
-		std::unordered_map<int, Note> notes;
-		std::unordered_map<int, HoldNote> holdNotes;
+		NoteStore notes;
+		CowMap<int, HoldNote> holdNotes;
 		std::vector<Tempo> tempoChanges;
 		std::map<int, TimeSignature> timeSignatures;
 		std::vector<HiSpeedChange> hiSpeedChanges;
@@ -50,8 +71,59 @@ namespace MikuMikuWorld
 		Fever fever;
 
 		Score();
+
+		// notes with ticks in [first, last] ordered by tick then lane.
+		// the returned range is invalidated by the next query following an edit
+		NoteRange notesInTickRange(int first, int last) const;
+
+		// must be called after notes are added, removed or moved
+		inline void invalidateNoteIndex() { noteIndexDirty = true; }
+
+		const TempoMap& getTempoMap() const;
+
+		// must be called after tempo changes are added, removed or edited
+		inline void invalidateTempoMap() { tempoMapDirty = true; }
+
+		const MeasureMap& getMeasureMap() const;
+
+		// must be called after time signatures are added, removed or edited
+		inline void invalidateMeasureMap() { measureMapDirty = true; }
+
+	private:
+		// shared between copies of the score until either of them rebuilds it
+		mutable std::shared_ptr<const std::vector<NoteIndexEntry>> noteIndex;
+		mutable bool noteIndexDirty{ true };
+
+		mutable TempoMap tempoMap;
+		mutable bool tempoMapDirty{ true };
+
+		mutable MeasureMap measureMap;
+		mutable bool measureMapDirty{ true };
+
+		void rebuildNoteIndex() const;
+	};
+
+	struct ScoreInfo
+	{
+		int version;
+		int tapCount;
+		int holdCount;
+		ScoreMetadata metadata;
 	};
 
-	Score deserializeScore(const std::string& filename);
-	void serializeScore(const Score& score, const std::string& filename);
+	// note IDs in the order they are stored in a MMWS file along with the file's size and hash
+	struct MmwsLayout
+	{
+		uint32_t checksum{};
+		size_t fileSize{};
+		std::vector<int> noteIDs;
+	};
+
+	// the committed edits of the file's journal are replayed over the file.
+	// the journal is left open for further edits if one is passed
+	Score deserializeScore(const std::string& filename, EditJournal* journal = nullptr);
+
+	// reads the header and metadata without decoding any notes
+	ScoreInfo readScoreInfo(const std::string& filename);
+	void serializeScore(const Score& score, const std::string& filename, MmwsLayout* layout = nullptr);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "IO.h"
 #include "Utilities.h"
 #include "UI.h"
+#include <utility>
 
 #undef min
 #undef max
@@ -18,10 +19,10 @@ namespace MikuMikuWorld
 			return;
 
 		bool edit = false;
-		Score prev = score;
+		History change("Change step type");
 		for (int id : selectedNotes)
 		{
-			const Note& note = score.notes.at(id);
+			const Note& note = std::as_const(score).notes.at(id);
 			if (note.getType() != NoteType::HoldMid)
 				continue;
 
@@ -29,6 +30,7 @@ namespace MikuMikuWorld
 			int pos = findHoldStep(hold, id);
 			if (pos != -1)
 			{
+				change.recordHold(score, note.parentID);
 				if (type == HoldStepType::HoldStepTypeCount)
 				{
 					cycleStepType(hold.steps[pos]);
@@ -44,7 +46,10 @@ namespace MikuMikuWorld
 		}
 
 		if (edit)
-			history.pushHistory("Change step type", prev, score);
+		{
+			change.commit(score);
+			history.pushHistory(change);
+		}
 	}
 
 	void ScoreContext::setFlick(FlickType flick)
@@ -53,12 +58,13 @@ namespace MikuMikuWorld
 			return;
 
 		bool edit = false;
-		Score prev = score;
+		History change("Change flick");
 		for (int id : selectedNotes)
 		{
-			Note& note = score.notes.at(id);
+			NoteRef note = score.notes.at(id);
 			if (!note.hasEase())
 			{
+				change.recordNote(score, id);
 				if (flick == FlickType::FlickTypeCount)
 				{
 					cycleFlick(note);
@@ -73,7 +79,10 @@ namespace MikuMikuWorld
 		}
 
 		if (edit)
-			history.pushHistory("Change flick", prev, score);
+		{
+			change.commit(score);
+			history.pushHistory(change);
+		}
 	}
 
 	void ScoreContext::setEase(EaseType ease)
@@ -82,12 +91,13 @@ namespace MikuMikuWorld
 			return;
 
 		bool edit = false;
-		Score prev = score;
+		History change("Change ease");
 		for (int id : selectedNotes)
 		{
-			Note& note = score.notes.at(id);
+			NoteRef note = score.notes.at(id);
 			if (note.getType() == NoteType::Hold)
 			{
+				change.recordHold(score, note.ID);
 				if (ease == EaseType::EaseTypeCount)
 				{
 					cycleStepEase(score.holdNotes.at(note.ID).start);
@@ -105,6 +115,7 @@ namespace MikuMikuWorld
 				int pos = findHoldStep(hold, id);
 				if (pos != -1)
 				{
+					change.recordHold(score, note.parentID);
 					if (ease == EaseType::EaseTypeCount)
 					{
 						cycleStepEase(hold.steps[pos]);
@@ -121,7 +132,10 @@ namespace MikuMikuWorld
 		}
 
 		if (edit)
-			history.pushHistory("Change ease", prev, score);
+		{
+			change.commit(score);
+			history.pushHistory(change);
+		}
 	}
 
 	void ScoreContext::toggleCriticals()
@@ -129,19 +143,21 @@ namespace MikuMikuWorld
 		if (!selectedNotes.size())
 			return;
 
-		Score prev = score;
+		History change("Change note");
 		std::unordered_set<int> critHolds;
 		for (int id : selectedNotes)
 		{
-			Note& note = score.notes.at(id);
+			NoteRef note = score.notes.at(id);
 			if (note.getType() == NoteType::Tap)
 			{
+				change.recordNote(score, id);
 				note.critical ^= true;
 			}
 			else if (note.getType() == NoteType::HoldEnd && note.isFlick())
 			{
+				change.recordNote(score, id);
 				// if the start is critical the entire hold must be critical
-				note.critical = score.notes.at(note.parentID).critical ? true : !note.critical;
+				note.critical = std::as_const(score).notes.at(note.parentID).critical ? true : !note.critical;
 			}
 			else
 			{
@@ -153,7 +169,12 @@ namespace MikuMikuWorld
 		{
 			// flip critical state
 			HoldNote& note = score.holdNotes.at(hold);
-			bool critical = !score.notes.at(note.start.ID).critical;
+			bool critical = !std::as_const(score).notes.at(note.start.ID).critical;
+
+			change.recordNote(score, note.start.ID);
+			change.recordNote(score, note.end);
+			for (const auto& step : note.steps)
+				change.recordNote(score, step.ID);
 
 			// again if the hold start is critical, every note in the hold must be critical
 			score.notes.at(note.start.ID).critical = critical;
@@ -162,7 +183,8 @@ namespace MikuMikuWorld
 				score.notes.at(step.ID).critical = critical;
 		}
 
-		history.pushHistory("Change note", prev, score);
+		change.commit(score);
+		history.pushHistory(change);
 	}
 
 	void ScoreContext::deleteSelection()
@@ -170,14 +192,14 @@ namespace MikuMikuWorld
 		if (!selectedNotes.size())
 			return;
 
-		Score prev = score;
+		History change("Delete notes");
 		for (auto& id : selectedNotes)
 		{
 			auto notePos = score.notes.find(id);
 			if (notePos == score.notes.end())
 				continue;
 
-			Note& note = notePos->second;
+			const Note note = notePos->second;
 			if (note.getType() != NoteType::Hold && note.getType() != NoteType::HoldEnd)
 			{
 				if (note.getType() == NoteType::HoldMid)
@@ -185,15 +207,23 @@ namespace MikuMikuWorld
 					// find hold step and remove it from the steps data container
 					if (score.holdNotes.find(note.parentID) != score.holdNotes.end())
 					{
+						change.recordHold(score, note.parentID);
 						for (auto it = score.holdNotes.at(note.parentID).steps.begin(); it != score.holdNotes.at(note.parentID).steps.end(); ++it)
 							if (it->ID == id) { score.holdNotes.at(note.parentID).steps.erase(it); break; }
 					}
 				}
+				change.recordNote(score, id);
 				score.notes.erase(id);
 			}
 			else
 			{
-				const HoldNote& hold = score.holdNotes.at(note.getType() == NoteType::Hold ? note.ID : note.parentID);
+				const HoldNote& hold = std::as_const(score).holdNotes.at(note.getType() == NoteType::Hold ? note.ID : note.parentID);
+				change.recordHold(score, hold.start.ID);
+				change.recordNote(score, hold.start.ID);
+				change.recordNote(score, hold.end);
+				for (const auto& step : hold.steps)
+					change.recordNote(score, step.ID);
+
 				score.notes.erase(hold.start.ID);
 				score.notes.erase(hold.end);
 
@@ -206,15 +236,16 @@ namespace MikuMikuWorld
 		}
 
 		selectedNotes.clear();
-		pushHistory("Delete notes", prev, score);
+		pushHistory(change);
 	}
 
 	void ScoreContext::flipSelection()
 	{
-		Score prev = score;
+		History change("Flip notes");
 		for (int id : selectedNotes)
 		{
-			Note& note = score.notes.at(id);
+			change.recordNote(score, id);
+			NoteRef note = score.notes.at(id);
 			note.lane = MAX_LANE - note.lane - note.width + 1;
 
 			if (note.flick == FlickType::Left)
@@ -223,7 +254,7 @@ namespace MikuMikuWorld
 				note.flick = FlickType::Left;
 		}
 
-		pushHistory("Flip notes", prev, score);
+		pushHistory(change);
 	}
 
 	void ScoreContext::cutSelection()
@@ -341,8 +372,9 @@ namespace MikuMikuWorld
 
 		if (flip)
 		{
-			for (auto& [_, note] : pasteData.notes)
+			for (int id = 0; id < baseId; ++id)
 			{
+				NoteRef note = pasteData.notes.at(id);
 				note.lane = MAX_LANE - note.lane - note.width + 1;
 
 				if (note.flick == FlickType::Left)
@@ -373,18 +405,24 @@ namespace MikuMikuWorld
 
 	void ScoreContext::confirmPaste()
 	{
-		Score prev = score;
+		History change("Paste notes");
 
 		// update IDs and copy notes
-		for (auto& [_, note] : pasteData.notes)
+		selectedNotes.clear();
+		for (const auto& [_, pasted] : pasteData.notes)
 		{
+			Note note = pasted;
 			note.ID += nextID;
 			if (note.parentID != -1)
 				note.parentID += nextID;
 
 			note.lane += pasteData.offsetLane;
 			note.tick += pasteData.offsetTicks;
-			score.notes[note.ID] = note;
+			change.recordNote(score, note.ID);
+			score.notes.insert(note);
+
+			// select newly pasted notes
+			selectedNotes.insert(note.ID);
 		}
 
 		for (auto& [_, hold] : pasteData.holds)
@@ -394,18 +432,13 @@ namespace MikuMikuWorld
 			for (auto& step : hold.steps)
 				step.ID += nextID;
 
+			change.recordHold(score, hold.start.ID);
 			score.holdNotes[hold.start.ID] = hold;
 		}
-		
-		// select newly pasted notes
-		selectedNotes.clear();
-		std::transform(pasteData.notes.begin(), pasteData.notes.end(),
-			std::inserter(selectedNotes, selectedNotes.end()),
-			[this](const auto& it) { return it.second.ID; });
 
 		nextID += pasteData.notes.size();
 		pasteData.pasting = false;
-		pushHistory("Paste notes", prev, score);
+		pushHistory(change);
 	}
 
 	void ScoreContext::paste(bool flip)
@@ -425,13 +458,14 @@ namespace MikuMikuWorld
 		if (selectedNotes.size() < 2)
 			return;
 
-		Score prev = score;
+		History change("Shrink notes");
+		recordSelection(change);
 
 		std::vector<int> sortedSelection(selectedNotes.begin(), selectedNotes.end());
 		std::sort(sortedSelection.begin(), sortedSelection.end(), [this](int a, int b) 
 		{
-			const Note& n1 = score.notes.at(a);
-			const Note& n2 = score.notes.at(b);
+			const Note& n1 = std::as_const(score).notes.at(a);
+			const Note& n2 = std::as_const(score).notes.at(b);
 			return n1.tick == n2.tick ? n1.lane < n2.lane : n1.tick < n2.tick;
 		});
 
@@ -443,7 +477,7 @@ namespace MikuMikuWorld
 			factor = -1;
 		}
 
-		int firstTick = score.notes.at(*sortedSelection.begin()).tick;
+		int firstTick = std::as_const(score).notes.at(*sortedSelection.begin()).tick;
 		for (int i = 0; i < sortedSelection.size(); ++i)
 			score.notes[sortedSelection[i]].tick = firstTick + (i * factor);
 
@@ -451,14 +485,30 @@ namespace MikuMikuWorld
 		for (const auto& hold : holds)
 			sortHoldSteps(score, score.holdNotes.at(hold));
 
-		pushHistory("Shrink notes", prev, score);
+		pushHistory(change);
+	}
+
+	ScoreMetadata ScoreContext::getWorkingMetadata() const
+	{
+		ScoreMetadata metadata = score.metadata;
+		metadata.title = workingData.title;
+		metadata.author = workingData.designer;
+		metadata.artist = workingData.artist;
+		metadata.musicFile = workingData.musicFilename;
+		metadata.musicOffset = workingData.musicOffset;
+		metadata.jacketFile = workingData.jacket.getFilename();
+
+		return metadata;
 	}
 
 	void ScoreContext::undo()
 	{
 		if (history.hasUndo())
 		{
-			score = history.undo();
+			history.undo(score);
+			score.invalidateNoteIndex();
+			score.invalidateTempoMap();
+			score.invalidateMeasureMap();
 			clearSelection();
 
 			UI::setWindowTitle((workingData.filename.size() ? File::getFilename(workingData.filename) : windowUntitled) + "*");
@@ -472,7 +522,10 @@ namespace MikuMikuWorld
 	{
 		if (history.hasRedo())
 		{
-			score = history.redo();
+			history.redo(score);
+			score.invalidateNoteIndex();
+			score.invalidateTempoMap();
+			score.invalidateMeasureMap();
 			clearSelection();
 
 			UI::setWindowTitle((workingData.filename.size() ? File::getFilename(workingData.filename) : windowUntitled) + "*");
@@ -482,9 +535,32 @@ namespace MikuMikuWorld
 		}
 	}
 
-	void ScoreContext::pushHistory(std::string description, const Score& prev, const Score& curr)
+	void ScoreContext::recordSelection(History& change) const
+	{
+		for (int id : selectedNotes)
+		{
+			const Note& note = score.notes.at(id);
+			if (note.getType() == NoteType::Tap)
+			{
+				change.recordNote(score, id);
+				continue;
+			}
+
+			// edits on a hold note may reorder or swap any of the hold's notes
+			const HoldNote& hold = score.holdNotes.at(note.getType() == NoteType::Hold ? note.ID : note.parentID);
+			change.recordHold(score, hold.start.ID);
+			change.recordNote(score, hold.start.ID);
+			change.recordNote(score, hold.end);
+			for (const auto& step : hold.steps)
+				change.recordNote(score, step.ID);
+		}
+	}
+
+	void ScoreContext::pushHistory(History& change)
 	{
-		history.pushHistory(description, prev, curr);
+		change.commit(score);
+		history.pushHistory(change);
+		score.invalidateNoteIndex();
 
 		UI::setWindowTitle((workingData.filename.size() ? File::getFilename(workingData.filename) : windowUntitled) + "*");
 		scoreStats.calculateStats(score);
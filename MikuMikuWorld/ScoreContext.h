@@ -2,6 +2,7 @@
 #include "Score.h"
 #include "ScoreStats.h"
 #include "HistoryManager.h"
+#include "EditJournal.h"
 #include "Audio/AudioManager.h"
 #include "JsonIO.h"
 #include "Jacket.h"
@@ -36,7 +37,7 @@ namespace MikuMikuWorld
 
 	struct PasteData
 	{
-		std::unordered_map<int, Note> notes;
+		NoteStore notes;
 		std::unordered_map<int, HoldNote> holds;
 		bool pasting{ false };
 		int offsetTicks{};
@@ -53,6 +54,7 @@ namespace MikuMikuWorld
 		EditorScoreData workingData;
 		ScoreStats scoreStats;
 		HistoryManager history;
+		EditJournal journal;
 		AudioManager audio;
 		PasteData pasteData{};
 		std::unordered_set<int> selectedNotes;
@@ -60,7 +62,9 @@ namespace MikuMikuWorld
 		int currentTick{};
 		bool upToDate{ true };
 
-		std::unordered_set<int> getHoldsFromSelection()
+		ScoreContext() { history.setJournal(&journal); }
+
+		std::unordered_set<int> getHoldsFromSelection() const
 		{
 			std::unordered_set<int> holds;
 			for (int id : selectedNotes)
@@ -79,7 +83,7 @@ namespace MikuMikuWorld
 		bool selectionHasStep() const;
 		bool selectionHasFlickable() const;
 		inline bool isNoteSelected(const Note& note) { return selectedNotes.find(note.ID) != selectedNotes.end(); }
-		inline void selectAll() { selectedNotes.clear(); for (auto& it : score.notes) selectedNotes.insert(it.first); }
+		inline void selectAll() { selectedNotes.clear(); for (const auto& it : score.notes) selectedNotes.insert(it.first); }
 		inline void clearSelection() { selectedNotes.clear(); }
 
 		void setStep(HoldStepType step);
@@ -99,6 +103,12 @@ namespace MikuMikuWorld
 
 		void undo();
 		void redo();
-		void pushHistory(std::string description, const Score& prev, const Score& current);
+
+		// score metadata filled from the working data shown in the editor
+		ScoreMetadata getWorkingMetadata() const;
+
+		// records the selected notes along with every note of their holds
+		void recordSelection(History& change) const;
+		void pushHistory(History& change);
 	};
 }
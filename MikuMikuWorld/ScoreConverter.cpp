@@ -3,14 +3,54 @@
 #include "Score.h"
 #include <stdexcept>
 #include "Constants.h"
-#include <unordered_set>
 #include <algorithm>
+#include <cmath>
 
 namespace MikuMikuWorld
 {
-	std::string ScoreConverter::noteKey(const SUSNote& note)
+	// SUS directional types indexed by FlickType
+	constexpr int susFlickTypes[] = { 0, 1, 3, 4 };
+
+	// what the taps and directionals at a note's tick and lane say about it
+	struct SusNoteAttributes
+	{
+		FlickType flick{ FlickType::None };
+		bool critical{ false };
+		bool stepIgnore{ false };
+		bool easeIn{ false };
+		bool easeOut{ false };
+		bool slide{ false };
+		bool tapAdded{ false };
+	};
+
+	// sorted note keys with the attributes of each key at the same index
+	class SusNoteAttributeTable
 	{
-		return std::to_string(note.tick) + "-" + std::to_string(note.lane);
+	private:
+		std::vector<uint64_t> keys;
+		std::vector<SusNoteAttributes> attributes;
+
+	public:
+		void reserve(size_t count) { keys.reserve(count); }
+		void addKey(uint64_t key) { keys.push_back(key); }
+
+		void build()
+		{
+			std::sort(keys.begin(), keys.end());
+			keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+			attributes.resize(keys.size());
+		}
+
+		// the key must have been added before build
+		SusNoteAttributes& at(uint64_t key)
+		{
+			return attributes[std::lower_bound(keys.begin(), keys.end(), key) - keys.begin()];
+		}
+	};
+
+	uint64_t ScoreConverter::noteKey(const SUSNote& note)
+	{
+		return ((uint64_t)(uint32_t)note.tick << 32) | (uint32_t)note.lane;
 	}
 
 	std::pair<int, int> ScoreConverter::barLengthToFraction(float length, float fractionDenom)
@@ -39,12 +79,25 @@ namespace MikuMikuWorld
 			sus.metadata.waveOffset * 1000 // seconds -> milliseconds
 		};
 
-		std::unordered_map<std::string, FlickType> flicks;
-		std::unordered_set<std::string> criticals;
-		std::unordered_set<std::string> stepIgnore;
-		std::unordered_set<std::string> easeIns;
-		std::unordered_set<std::string> easeOuts;
-		std::unordered_set<std::string> slideKeys;
+		size_t slideNoteCount = 0;
+		for (const auto& slide : sus.slides)
+			slideNoteCount += slide.size();
+
+		SusNoteAttributeTable table;
+		table.reserve(sus.taps.size() + sus.directionals.size() + slideNoteCount);
+		for (const auto& tap : sus.taps)
+			table.addKey(noteKey(tap));
+
+		for (const auto& dir : sus.directionals)
+			table.addKey(noteKey(dir));
+
+		for (const auto& slide : sus.slides)
+		{
+			for (const auto& note : slide)
+				table.addKey(noteKey(note));
+		}
+
+		table.build();
 
 		for (const auto& slide : sus.slides)
 		{
@@ -56,31 +109,31 @@ namespace MikuMikuWorld
 				case 2:
 				case 3:
 				case 5:
-					slideKeys.insert(noteKey(note));
+					table.at(noteKey(note)).slide = true;
 				}
 			}
 		}
 
 		for (const auto& dir : sus.directionals)
 		{
-			const std::string key = noteKey(dir);
+			SusNoteAttributes& attributes = table.at(noteKey(dir));
 			switch (dir.type)
 			{
 			case 1:
-				flicks.insert_or_assign(key, FlickType::Default);
+				attributes.flick = FlickType::Default;
 				break;
 			case 3:
-				flicks.insert_or_assign(key, FlickType::Left);
+				attributes.flick = FlickType::Left;
 				break;
 			case 4:
-				flicks.insert_or_assign(key, FlickType::Right);
+				attributes.flick = FlickType::Right;
 				break;
 			case 2:
-				easeIns.insert(key);
+				attributes.easeIn = true;
 				break;
 			case 5:
 			case 6:
-				easeOuts.insert(key);
+				attributes.easeOut = true;
 				break;
 			default:
 				break;
@@ -89,27 +142,24 @@ namespace MikuMikuWorld
 
 		for (const auto& tap : sus.taps)
 		{
-			const std::string key = noteKey(tap);
+			SusNoteAttributes& attributes = table.at(noteKey(tap));
 			switch (tap.type)
 			{
 			case 2:
-				criticals.insert(key);
+				attributes.critical = true;
 				break;
 			case 3:
-				stepIgnore.insert(key);
+				attributes.stepIgnore = true;
 				break;
 			default:
 				break;
 			}
 		}
 
-		std::unordered_set<std::string> tapKeys;
-		tapKeys.reserve(sus.taps.size());
-
-		std::unordered_map<int, Note> notes;
+		NoteStore notes;
 		notes.reserve(sus.taps.size());
 
-		std::unordered_map<int, HoldNote> holds;
+		CowMap<int, HoldNote> holds;
 		holds.reserve(sus.slides.size());
 
 		std::vector<SkillTrigger> skills;
@@ -132,20 +182,20 @@ namespace MikuMikuWorld
 			if (note.lane - 2 < MIN_LANE || note.lane - 2 > MAX_LANE)
 				continue;
 
-			const std::string key = noteKey(note);
-			if (slideKeys.find(key) != slideKeys.end() || (note.type != 1 && note.type != 2))
+			SusNoteAttributes& attributes = table.at(noteKey(note));
+			if (attributes.slide || (note.type != 1 && note.type != 2))
 				continue;
 
-			if (tapKeys.find(key) != tapKeys.end())
+			if (attributes.tapAdded)
 				continue;
 
-			tapKeys.insert(key);
+			attributes.tapAdded = true;
 			Note n(NoteType::Tap);
 			n.tick = note.tick;
 			n.lane = note.lane - 2;
 			n.width = note.width;
 			n.critical = note.type == 2;
-			n.flick = flicks.find(key) != flicks.end() ? flicks[key] : FlickType::None;
+			n.flick = attributes.flick;
 			n.ID = nextID++;
 
 			notes[n.ID] = n;
@@ -153,15 +203,13 @@ namespace MikuMikuWorld
 
 		for (const auto& slide : sus.slides)
 		{
-			const std::string key = noteKey(slide[0]);
-
 			auto start = std::find_if(slide.begin(), slide.end(),
 				[](const SUSNote& a) { return a.type == 1 || a.type == 2; });
 
 			if (start == slide.end())
 				continue;
 
-			bool critical = criticals.find(key) != criticals.end();
+			bool critical = table.at(noteKey(slide[0])).critical;
 
 			HoldNote hold;
 			int startID = nextID++;
@@ -169,12 +217,12 @@ namespace MikuMikuWorld
 
 			for (const auto& note : slide)
 			{
-				const std::string key = noteKey(note);
+				const SusNoteAttributes& attributes = table.at(noteKey(note));
 
 				EaseType ease = EaseType::Linear;
-				if (easeIns.find(key) != easeIns.end())
+				if (attributes.easeIn)
 					ease = EaseType::EaseIn;
-				else if (easeOuts.find(key) != easeOuts.end())
+				else if (attributes.easeOut)
 					ease = EaseType::EaseOut;
 
 				switch (note.type)
@@ -200,10 +248,10 @@ namespace MikuMikuWorld
 					n.tick = note.tick;
 					n.lane = note.lane - 2;
 					n.width = note.width;
-					n.critical = (critical ? true : (criticals.find(key) != criticals.end()));
+					n.critical = critical || attributes.critical;
 					n.ID = nextID++;
 					n.parentID = startID;
-					n.flick = flicks.find(key) != flicks.end() ? flicks[key] : FlickType::None;
+					n.flick = attributes.flick;
 
 					notes[n.ID] = n;
 					hold.end = n.ID;
@@ -223,7 +271,7 @@ namespace MikuMikuWorld
 					n.parentID = startID;
 
 					HoldStepType type = note.type == 3 ? HoldStepType::Normal : HoldStepType::Hidden;
-					if (stepIgnore.find(key) != stepIgnore.end())
+					if (attributes.stepIgnore)
 						type = HoldStepType::Skip;
 
 					notes[n.ID] = n;
@@ -280,11 +328,6 @@ namespace MikuMikuWorld
 
 	SUS ScoreConverter::scoreToSus(const Score& score)
 	{
-		std::unordered_map<FlickType, int> flickToType;
-		flickToType[FlickType::Default] = 1;
-		flickToType[FlickType::Left] = 3;
-		flickToType[FlickType::Right] = 4;
-
 		std::vector<SUSNote> taps, directionals;
 		std::vector<std::vector<SUSNote>> slides;
 		std::vector<BPM> bpms;
@@ -297,7 +340,7 @@ namespace MikuMikuWorld
 			{
 				taps.push_back(SUSNote{ note.tick, note.lane + 2, note.width, note.critical ? 2 : 1 });
 				if (note.isFlick())
-					directionals.push_back(SUSNote{ note.tick, note.lane + 2, note.width, flickToType[note.flick] });
+					directionals.push_back(SUSNote{ note.tick, note.lane + 2, note.width, susFlickTypes[(int)note.flick] });
 			}
 		}
 
@@ -338,7 +381,7 @@ namespace MikuMikuWorld
 			slide.push_back(SUSNote{ end.tick, end.lane + 2, end.width, 2 });
 			if (end.isFlick())
 			{
-				directionals.push_back(SUSNote{ end.tick, end.lane + 2, end.width, flickToType[end.flick] });
+				directionals.push_back(SUSNote{ end.tick, end.lane + 2, end.width, susFlickTypes[(int)end.flick] });
 				if (end.critical)
 					taps.push_back(SUSNote{ end.tick, end.lane + 2, end.width, 2 });
 			}
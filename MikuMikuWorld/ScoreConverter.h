@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <cstdint>
 
 namespace MikuMikuWorld
 {
@@ -11,7 +12,8 @@ namespace MikuMikuWorld
 	{
 	private:
 		static std::pair<int, int> barLengthToFraction(float length, float fractionDenom);
-		static std::string noteKey(const SUSNote& note);
+		// tick and lane packed into one integer
+		static uint64_t noteKey(const SUSNote& note);
 
 	public:
 		static Score susToScore(const SUS& sus);
@@ -43,6 +43,7 @@ namespace MikuMikuWorld
 		context.audio.initAudio();
 
 		exportComment = IO::concat("This file was generated by " APP_NAME, Application::getAppVersion().c_str(), " ");
+		autoSave.start(Application::getAppDir() + "auto_save");
 	}
 
 	void ScoreEditor::update()
@@ -138,6 +139,8 @@ namespace MikuMikuWorld
 
 		if (showImGuiDemoWindow)
 			ImGui::ShowDemoWindow(&showImGuiDemoWindow);
+
+		autoSave.update(context);
 	}
 
 	void ScoreEditor::create()
@@ -145,6 +148,7 @@ namespace MikuMikuWorld
 		context.score = {};
 		context.workingData = {};
 		context.history.clear();
+		context.journal.close();
 		context.scoreStats.reset();
 		context.audio.disposeBGM();
 		context.upToDate = true; // new score; nothing to save
@@ -157,6 +161,7 @@ namespace MikuMikuWorld
 
 		// backup next note ID in case of an import failure
 		int nextIdBackup = nextID;
+		bool recovered = false;
 		try
 		{
 			resetNextID();
@@ -165,11 +170,24 @@ namespace MikuMikuWorld
 				SusParser susParser;
 				context.score = ScoreConverter::susToScore(susParser.parse(filename));
 				context.workingData.filename = "";
+				context.journal.close();
 			}
 			else if (extension == MMWS_EXTENSION)
 			{
-				context.score = deserializeScore(filename);
+				context.score = deserializeScore(filename, &context.journal);
 				context.workingData.filename = filename;
+
+				if (context.journal.hasUncommittedEdits())
+				{
+					std::string message = "The score has unsaved edits from a session that did not close properly.\nDo you want to restore them?";
+					recovered = IO::messageBox(APP_NAME, message, IO::MessageBoxButtons::YesNo, IO::MessageBoxIcon::Question) == IO::MessageBoxResult::Yes;
+					if (recovered)
+						context.journal.replayUncommitted(context.score);
+					else
+						context.journal.discardUncommitted();
+				}
+
+				context.journal.setActive(config.editJournalEnabled);
 			}
 
 			context.workingData.title = context.score.metadata.title;
@@ -186,8 +204,8 @@ namespace MikuMikuWorld
 			context.scoreStats.calculateStats(context.score);
 			timeline.calculateMaxOffsetFromScore(context.score);
 
-			UI::setWindowTitle((context.workingData.filename.size() ? IO::File::getFilename(context.workingData.filename) : windowUntitled));
-			context.upToDate = true;
+			UI::setWindowTitle((context.workingData.filename.size() ? IO::File::getFilename(context.workingData.filename) : windowUntitled) + std::string(recovered ? "*" : ""));
+			context.upToDate = !recovered;
 		}
 		catch (std::runtime_error& err)
 		{
@@ -205,6 +223,25 @@ namespace MikuMikuWorld
 			loadScore(filename);
 	}
 
+	void ScoreEditor::offerRecovery()
+	{
+		const std::string& filename = autoSave.getRecoveryFile();
+		if (!filename.size())
+			return;
+
+		std::string message = "The previous session did not close properly.\nDo you want to recover the latest auto save?\n" + filename;
+		if (IO::messageBox(APP_NAME, message, IO::MessageBoxButtons::YesNo, IO::MessageBoxIcon::Question) != IO::MessageBoxResult::Yes)
+			return;
+
+		loadScore(filename);
+		context.journal.close();
+
+		// the recovered score has to be saved somewhere other than the auto save directory
+		context.workingData.filename = "";
+		context.upToDate = false;
+		UI::setWindowTitle(std::string(windowUntitled) + "*");
+	}
+
 	bool ScoreEditor::trySave(std::string filename)
 	{
 		try
@@ -226,13 +263,16 @@ namespace MikuMikuWorld
 
 	bool ScoreEditor::save(std::string filename)
 	{
-		context.score.metadata.title = context.workingData.title;
-		context.score.metadata.author = context.workingData.designer;
-		context.score.metadata.artist = context.workingData.artist;
-		context.score.metadata.musicFile = context.workingData.musicFilename;
-		context.score.metadata.musicOffset = context.workingData.musicOffset;
-		context.score.metadata.jacketFile = context.workingData.jacket.getFilename();
-		serializeScore(context.score, filename);
+		context.score.metadata = context.getWorkingMetadata();
+
+		// with the journal enabled, saving the file it was loaded from only appends a commit record
+		bool committed = config.editJournalEnabled && context.journal.canCommit(filename) && context.journal.commit(context.score.metadata);
+		if (!committed)
+		{
+			MmwsLayout layout;
+			serializeScore(context.score, filename, &layout);
+			context.journal.reset(filename, layout, context.score.metadata, config.editJournalEnabled);
+		}
 
 		UI::setWindowTitle(IO::File::getFilename(filename));
 		context.upToDate = true;
@@ -257,9 +297,18 @@ namespace MikuMikuWorld
 		std::string filename;
 		if (IO::FileDialog::saveFile(filename, IO::FileType::SUSFile))
 		{
-			SusExporter exporter;
-			SUS sus = ScoreConverter::scoreToSus(context.score);
-			exporter.dump(sus, filename, exportComment);
+			try
+			{
+				SusExporter exporter;
+				SUS sus = ScoreConverter::scoreToSus(context.score);
+				exporter.dump(sus, filename, exportComment);
+			}
+			catch (std::runtime_error& error)
+			{
+				std::string msg{ "An error occured while exporting the chart.\n" };
+				msg.append(error.what());
+				IO::messageBox(APP_NAME, msg.c_str(), IO::MessageBoxButtons::Ok, IO::MessageBoxIcon::Error);
+			}
 		}
 	}
 
@@ -1,4 +1,5 @@
 #include "ScoreEditorWindows.h"
+#include "AutoSave.h"
 
 namespace MikuMikuWorld
 {
@@ -16,6 +17,7 @@ namespace MikuMikuWorld
 		PresetsWindow presetsWindow{};
 		SettingsWindow settingsWindow{};
 		AboutDialog aboutDialog{};
+		AutoSave autoSave;
 
 		std::string exportComment;
 		bool showImGuiDemoWindow;
@@ -30,6 +32,7 @@ namespace MikuMikuWorld
 		void create();
 		void open();
 		void loadScore(std::string filename);
+		void offerRecovery();
 		void exportSus();
 		bool saveAs();
 		bool trySave(std::string filename = "");
@@ -42,7 +45,7 @@ namespace MikuMikuWorld
 		inline void savePresets(std::string path) { presetManager.savePresets(path); }
 		inline void loadMusic(std::string path) { context.audio.changeBGM(path); }
 
-		inline void uninitialize() { context.audio.uninitAudio(); }
+		inline void uninitialize() { autoSave.stop(); context.journal.close(); context.audio.uninitAudio(); }
 		inline const char* getWorkingFilename() const { return context.workingData.filename.c_str(); }
 		constexpr inline bool isUpToDate() const { return context.upToDate; }
 	};
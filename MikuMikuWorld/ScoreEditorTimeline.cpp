@@ -8,6 +8,8 @@
 #include "NoteGraphics.h"
 #include "ApplicationConfiguration.h"
 #include <algorithm>
+#include <set>
+#include <utility>
 
 #undef min
 #undef max
@@ -61,6 +63,10 @@ namespace MikuMikuWorld
 
 	bool ScoreEditorTimeline::isNoteVisible(const Note& note, int offsetTicks) const
 	{
+		// note layer chunks are recorded whole
+		if (recordingNoteLayer)
+			return true;
+
 		const float y = getNoteYPosFromTick(note.tick + offsetTicks);
 		return y >= 0 && y <= size.y + position.y + 100;
 	}
@@ -79,7 +85,7 @@ namespace MikuMikuWorld
 
 	int ScoreEditorTimeline::snapTickFromPos(float posY, const ScoreContext& context)
 	{
-		return snapTick(positionToTick(posY), division, context.score.timeSignatures);
+		return context.score.getMeasureMap().snapTick(positionToTick(posY), division);
 	}
 
 	int ScoreEditorTimeline::laneFromCenterPosition(int lane, int width)
@@ -180,8 +186,11 @@ namespace MikuMikuWorld
 	void ScoreEditorTimeline::calculateMaxOffsetFromScore(const Score& score)
 	{
 		int maxTick = 0;
-		for (const auto& [id, note] : score.notes)
-			maxTick = std::max(maxTick, note.tick);
+		for (int slot = 0; slot < score.notes.slotCount(); ++slot)
+		{
+			if (score.notes.isUsed(slot))
+				maxTick = std::max(maxTick, score.notes.getTick(slot));
+		}
 
 		// current offset maybe greater than calculated offset from score
 		maxOffset = std::max(offset, (maxTick * unitHeight) + minOffset + 1000);
@@ -351,8 +360,12 @@ namespace MikuMikuWorld
 				context.selectedNotes.clear();
 
 			float yThreshold = (notesHeight * 0.5f) + 2.0f;
-			for (const auto& [id, note] : context.score.notes)
+			const int firstTick = positionToTick(-(bottom + yThreshold)) - 1;
+			const int lastTick = positionToTick(-(top - yThreshold)) + 1;
+			for (const auto& entry : context.score.notesInTickRange(firstTick, lastTick))
 			{
+				const int id = entry.ID;
+				const Note& note = std::as_const(context.score).notes.at(id);
 				float x1 = laneToPosition(note.lane);
 				float x2 = laneToPosition(note.lane + note.width);
 				float y = -tickToPosition(note.tick);
@@ -377,10 +390,11 @@ namespace MikuMikuWorld
 
 		int firstTick = std::max(0, positionToTick(visualOffset - size.y));
 		int lastTick = positionToTick(visualOffset);
-		int measure = accumulateMeasures(firstTick, TICKS_PER_BEAT, context.score.timeSignatures);
-		firstTick = measureToTicks(measure, TICKS_PER_BEAT, context.score.timeSignatures);
+		const MeasureMap& measureMap = context.score.getMeasureMap();
+		int measure = measureMap.ticksToMeasure(firstTick);
+		firstTick = measureMap.measureToTicks(measure);
 
-		int tsIndex = findTimeSignature(measure, context.score.timeSignatures);
+		int tsIndex = measureMap.getTimeSignature(measure).measure;
 		int numerator = context.score.timeSignatures[tsIndex].numerator;
 		int interval = (division / 4) * numerator; // the number of times a measure is divided
 
@@ -391,7 +405,7 @@ namespace MikuMikuWorld
 		for (int tick = firstTick; tick <= lastTick; tick += subDiv)
 		{
 			const float y = position.y - tickToPosition(tick) + visualOffset;
-			int currentMeasure = accumulateMeasures(tick, TICKS_PER_BEAT, context.score.timeSignatures);
+			int currentMeasure = measureMap.ticksToMeasure(tick);
 
 			// time signature changes on current measure
 			if (context.score.timeSignatures.find(currentMeasure) != context.score.timeSignatures.end())
@@ -406,7 +420,7 @@ namespace MikuMikuWorld
 			}
 
 			// determine whether the tick is a beat relative to its measure's tick
-			int measureTicks = measureToTicks(currentMeasure, TICKS_PER_BEAT, context.score.timeSignatures);
+			int measureTicks = measureMap.measureToTicks(currentMeasure);
 
 			if (!((tick - measureTicks) % beatTicks))
 				drawList->AddLine(ImVec2(x1, y), ImVec2(x2, y), divColor1, primaryLineThickness);
@@ -414,7 +428,7 @@ namespace MikuMikuWorld
 				drawList->AddLine(ImVec2(x1, y), ImVec2(x2, y), divColor2, secondaryLineThickness);
 		}
 
-		tsIndex = findTimeSignature(measure, context.score.timeSignatures);
+		tsIndex = measureMap.getTimeSignature(measure).measure;
 		ticksPerMeasure = beatsPerMeasure(context.score.timeSignatures[tsIndex]) * TICKS_PER_BEAT;
 
 		// overdraw one measure to make sure the measure string is always visible
@@ -473,7 +487,7 @@ namespace MikuMikuWorld
 		// update time signature changes
 		for (auto& [measure, ts] : context.score.timeSignatures)
 		{
-			if (timeSignatureControl(ts.numerator, ts.denominator, measureToTicks(ts.measure, TICKS_PER_BEAT, context.score.timeSignatures), !playing))
+			if (timeSignatureControl(ts.numerator, ts.denominator, context.score.getMeasureMap().measureToTicks(ts.measure), !playing))
 			{
 				eventEdit.editTimeSignatureIndex = measure;
 				eventEdit.editTimeSignatureNumerator = ts.numerator;
@@ -517,7 +531,7 @@ namespace MikuMikuWorld
 		// selection boxes
 		for (int id : context.selectedNotes)
 		{
-			const Note& note = context.score.notes.at(id);
+			const Note& note = std::as_const(context.score).notes.at(id);
 			if (!isNoteVisible(note, 0))
 				continue;
 
@@ -601,7 +615,7 @@ namespace MikuMikuWorld
 		if (activated)
 		{
 			gotoMeasure = std::clamp(gotoMeasure, 0, 999);
-			context.currentTick = measureToTicks(gotoMeasure, TICKS_PER_BEAT, context.score.timeSignatures);
+			context.currentTick = context.score.getMeasureMap().measureToTicks(gotoMeasure);
 			offset = std::max(minOffset, tickToPosition(context.currentTick) + (size.y * (1.0f - config.cursorPositionThreshold)));
 		}
 
@@ -613,8 +627,8 @@ namespace MikuMikuWorld
 		ImGui::SameLine();
 		ImGui::SeparatorEx(ImGuiSeparatorFlags_Vertical);
 		ImGui::SameLine();
-		int currentMeasure = accumulateMeasures(context.currentTick, TICKS_PER_BEAT, context.score.timeSignatures);
-		const TimeSignature& ts = context.score.timeSignatures[findTimeSignature(currentMeasure, context.score.timeSignatures)];
+		int currentMeasure = context.score.getMeasureMap().ticksToMeasure(context.currentTick);
+		const TimeSignature& ts = context.score.getMeasureMap().getTimeSignature(currentMeasure);
 		const Tempo& tempo = getTempoAt(context.currentTick, context.score.tempoChanges);
 
 		int hiSpeed = findHighSpeedChange(context.currentTick, context.score.hiSpeedChanges);
@@ -636,7 +650,7 @@ namespace MikuMikuWorld
 		if (playing)
 		{
 			time += ImGui::GetIO().DeltaTime;
-			context.currentTick = accumulateTicks(time, TICKS_PER_BEAT, context.score.tempoChanges);
+			context.currentTick = context.score.getTempoMap().secondsToTicks(time);
 
 			float cursorY = tickToPosition(context.currentTick);
 			if (config.followCursorInPlayback)
@@ -652,7 +666,7 @@ namespace MikuMikuWorld
 		}
 		else
 		{
-			time = accumulateDuration(context.currentTick, TICKS_PER_BEAT, context.score.tempoChanges);
+			time = context.score.getTempoMap().ticksToSeconds(context.currentTick);
 		}
 	}
 
@@ -667,41 +681,47 @@ namespace MikuMikuWorld
 
 		framebuffer->bind();
 		framebuffer->clear();
-		renderer->beginBatch();
 
 		minNoteYDistance = INT_MAX;
-		for (auto& [id, note] : context.score.notes)
+
+		// pad the visible range by a tick on each side to account for rounding in positionToTick
+		const int firstTick = positionToTick(visualOffset - size.y - position.y) - 1;
+		const int lastTick = positionToTick(visualOffset + 100) + 1;
+		for (const auto& entry : context.score.notesInTickRange(firstTick, lastTick))
 		{
-			if (isNoteVisible(note) && note.getType() == NoteType::Tap)
+			const Note& note = std::as_const(context.score).notes.at(entry.ID);
+			if (!isNoteVisible(note))
+				continue;
+
+			updateNote(context, note);
+			if (drawHoldStepOutlines && note.getType() == NoteType::HoldMid)
 			{
-				updateNote(context, note);
-				drawNote(note, renderer, noteTint);
+				const HoldNote& hold = std::as_const(context.score).holdNotes.at(note.parentID);
+				int pos = findHoldStep(hold, note.ID);
+				if (pos != -1)
+					drawSteps.emplace_back(StepDrawData{ note.tick, note.lane, note.width, hold.steps[pos].type });
 			}
 		}
 
-		for (auto& [id, hold] : context.score.holdNotes)
+		// drop curves of holds removed since the last edit
+		if (holdGeometryVersion != context.history.getVersion())
 		{
-			Note& start = context.score.notes.at(hold.start.ID);
-			Note& end = context.score.notes.at(hold.end);
-
-			if (isNoteVisible(start)) updateNote(context, start);
-			if (isNoteVisible(end)) updateNote(context, end);
+			for (auto it = holdGeometry.begin(); it != holdGeometry.end();)
+				it = context.score.holdNotes.find(it->first) == context.score.holdNotes.end() ? holdGeometry.erase(it) : std::next(it);
 
-			for (const auto& step : hold.steps)
-			{
-				Note& mid = context.score.notes.at(step.ID);
-				if (isNoteVisible(mid)) updateNote(context, mid);
-				if (skipUpdateAfterSortingSteps) break;
-			}
-
-			drawHoldNote(context.score.notes, hold, renderer, noteTint);
+			holdGeometryVersion = context.history.getVersion();
 		}
-		skipUpdateAfterSortingSteps = false;
 
-		renderer->endBatch();
+		updateNoteLayer(context);
+		drawNoteLayer(context.score, firstTick, lastTick, shader, renderer);
+
+		shader->setMatrix4("view", DirectX::XMMatrixIdentity());
 		renderer->beginBatch();
 
 		const bool pasting = context.pasteData.pasting;
+		if (!pasting)
+			pasteHoldGeometry.clear();
+
 		if (pasting && mouseInTimeline)
 		{
 			context.pasteData.offsetTicks = hoverTick;
@@ -746,6 +766,247 @@ namespace MikuMikuWorld
 		drawSteps.clear();
 	}
 
+	std::pair<int, int> ScoreEditorTimeline::getHoldTickRange(const Score& score, const HoldNote& hold) const
+	{
+		// the end can be dragged before the start until the edit is committed
+		const int startTick = score.notes.at(hold.start.ID).tick;
+		const int endTick = score.notes.at(hold.end).tick;
+		int minTick = std::min(startTick, endTick);
+		int maxTick = std::max(startTick, endTick);
+		for (const auto& step : hold.steps)
+		{
+			const int stepTick = score.notes.at(step.ID).tick;
+			minTick = std::min(minTick, stepTick);
+			maxTick = std::max(maxTick, stepTick);
+		}
+
+		return { minTick, maxTick };
+	}
+
+	void ScoreEditorTimeline::updateNoteLayer(const ScoreContext& context)
+	{
+		const Score& score = context.score;
+		const int version = context.history.getVersion();
+		const bool layoutChanged = noteLayerZoom != zoom || noteLayerLaneWidth != laneWidth || noteLayerNotesHeight != notesHeight;
+		if (!layoutChanged && noteLayerVersion == version)
+		{
+			// notes dragged in place only touch the chunks of the selection until the edit is committed
+			if (noteLayerSelectionEdited)
+				updateNoteLayerSelection(context);
+
+			noteLayerSelectionEdited = false;
+			return;
+		}
+
+		noteLayerSelectionEdited = false;
+		noteLayerVersion = version;
+		noteLayerZoom = zoom;
+		noteLayerLaneWidth = laneWidth;
+		noteLayerNotesHeight = notesHeight;
+
+		auto appendNote = [](std::vector<int>& key, const Note& note)
+		{
+			key.push_back(note.tick);
+			key.push_back(note.lane);
+			key.push_back(note.width);
+			key.push_back(note.critical);
+			key.push_back((int)note.flick);
+			key.push_back((int)note.getType());
+		};
+
+		const int chunkTicks = noteLayerChunkBeats * TICKS_PER_BEAT;
+		auto chunkOf = [chunkTicks](int tick) { return (int)std::floor((float)tick / chunkTicks); };
+
+		std::map<int, NoteLayerChunk> chunks;
+		auto getChunk = [&chunks](int index) -> NoteLayerChunk&
+		{
+			return chunks.try_emplace(index, NoteLayerChunk{ {}, {}, {}, INT_MAX, INT_MIN, true }).first->second;
+		};
+
+		noteLayerTapChunks.clear();
+		noteLayerHoldChunks.clear();
+		for (const auto& entry : score.notesInTickRange(INT_MIN, INT_MAX))
+		{
+			const Note& note = score.notes.at(entry.ID);
+			if (note.getType() != NoteType::Tap)
+				continue;
+
+			const int index = chunkOf(note.tick);
+			NoteLayerChunk& chunk = getChunk(index);
+			chunk.tapIDs.push_back(note.ID);
+			chunk.minTick = std::min(chunk.minTick, note.tick);
+			chunk.maxTick = std::max(chunk.maxTick, note.tick);
+			appendNote(chunk.key, note);
+			noteLayerTapChunks[note.ID] = index;
+		}
+
+		// holds belong to the chunk of their earliest note and extend its range to their last
+		for (const auto& [id, hold] : score.holdNotes)
+		{
+			const auto [minTick, maxTick] = getHoldTickRange(score, hold);
+			const int index = chunkOf(minTick);
+			NoteLayerChunk& chunk = getChunk(index);
+			chunk.holdIDs.push_back(id);
+			chunk.minTick = std::min(chunk.minTick, minTick);
+			chunk.maxTick = std::max(chunk.maxTick, maxTick);
+			noteLayerHoldChunks[id] = index;
+
+			chunk.key.push_back(-1);
+			chunk.key.push_back(hold.steps.size());
+			chunk.key.push_back((int)hold.start.ease);
+			appendNote(chunk.key, score.notes.at(hold.start.ID));
+			for (const auto& step : hold.steps)
+			{
+				chunk.key.push_back((int)step.type);
+				chunk.key.push_back((int)step.ease);
+				appendNote(chunk.key, score.notes.at(step.ID));
+			}
+			appendNote(chunk.key, score.notes.at(hold.end));
+		}
+
+		// chunks keep their buffers so a rebuild refills them, and only chunks whose notes changed are rebuilt
+		for (auto& [index, chunk] : chunks)
+		{
+			auto it = noteLayer.find(index);
+			if (it == noteLayer.end())
+				continue;
+
+			chunk.taps = std::move(it->second.taps);
+			chunk.holds = std::move(it->second.holds);
+			chunk.dirty = layoutChanged || it->second.dirty || it->second.key != chunk.key;
+		}
+
+		noteLayer = std::move(chunks);
+	}
+
+	void ScoreEditorTimeline::updateNoteLayerSelection(const ScoreContext& context)
+	{
+		const Score& score = context.score;
+		const int chunkTicks = noteLayerChunkBeats * TICKS_PER_BEAT;
+		auto chunkOf = [chunkTicks](int tick) { return (int)std::floor((float)tick / chunkTicks); };
+
+		// chunks the selection was in before this edit and is in after it
+		std::set<int> edited;
+		auto moveToChunk = [this, &edited](std::unordered_map<int, int>& chunkIndices, int id, int index, bool hold)
+		{
+			auto it = chunkIndices.find(id);
+			if (it != chunkIndices.end() && it->second == index)
+			{
+				edited.insert(index);
+				return;
+			}
+
+			if (it != chunkIndices.end())
+			{
+				std::vector<int>& ids = hold ? noteLayer.at(it->second).holdIDs : noteLayer.at(it->second).tapIDs;
+				ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+				edited.insert(it->second);
+			}
+
+			NoteLayerChunk& chunk = noteLayer.try_emplace(index, NoteLayerChunk{ {}, {}, {}, INT_MAX, INT_MIN, true }).first->second;
+			(hold ? chunk.holdIDs : chunk.tapIDs).push_back(id);
+			chunkIndices[id] = index;
+			edited.insert(index);
+		};
+
+		for (int id : context.selectedNotes)
+		{
+			const Note& note = score.notes.at(id);
+			if (note.getType() == NoteType::Tap)
+				moveToChunk(noteLayerTapChunks, id, chunkOf(note.tick), false);
+		}
+
+		for (int id : context.getHoldsFromSelection())
+			moveToChunk(noteLayerHoldChunks, id, chunkOf(getHoldTickRange(score, score.holdNotes.at(id)).first), true);
+
+		for (int index : edited)
+		{
+			NoteLayerChunk& chunk = noteLayer.at(index);
+			chunk.minTick = INT_MAX;
+			chunk.maxTick = INT_MIN;
+			for (int id : chunk.tapIDs)
+			{
+				const int tick = score.notes.at(id).tick;
+				chunk.minTick = std::min(chunk.minTick, tick);
+				chunk.maxTick = std::max(chunk.maxTick, tick);
+			}
+
+			for (int id : chunk.holdIDs)
+			{
+				const auto [minTick, maxTick] = getHoldTickRange(score, score.holdNotes.at(id));
+				chunk.minTick = std::min(chunk.minTick, minTick);
+				chunk.maxTick = std::max(chunk.maxTick, maxTick);
+			}
+
+			// the key no longer describes the geometry, so the chunk is rebuilt again once the edit is committed
+			chunk.key.clear();
+			chunk.dirty = true;
+		}
+	}
+
+	void ScoreEditorTimeline::drawNoteLayer(const Score& score, int firstTick, int lastTick, Shader* shader, Renderer* renderer)
+	{
+		const int chunkTicks = noteLayerChunkBeats * TICKS_PER_BEAT;
+		auto isChunkVisible = [firstTick, lastTick](const NoteLayerChunk& chunk)
+		{
+			return chunk.maxTick >= firstTick && chunk.minTick <= lastTick;
+		};
+
+		// chunks are built when they first come into view, with their first tick
+		// moved to y 0 and the lanes to x 0
+		const float savedVisualOffset = visualOffset;
+		const float savedLaneOffset = laneOffset;
+		for (auto& [index, chunk] : noteLayer)
+		{
+			if (!chunk.dirty || !isChunkVisible(chunk))
+				continue;
+
+			recordingNoteLayer = true;
+			visualOffset = position.y + size.y + tickToPosition(index * chunkTicks);
+			laneOffset = 0;
+
+			renderer->beginBatch();
+			for (int id : chunk.tapIDs)
+				drawNote(score.notes.at(id), renderer, noteTint);
+			renderer->endBatch(chunk.taps);
+
+			renderer->beginBatch();
+			for (int id : chunk.holdIDs)
+				drawHoldNote(score.notes, score.holdNotes.at(id), holdGeometry, renderer, noteTint);
+			renderer->endBatch(chunk.holds);
+
+			chunk.dirty = false;
+		}
+
+		recordingNoteLayer = false;
+		visualOffset = savedVisualOffset;
+		laneOffset = savedLaneOffset;
+
+		const float baseY = position.y + size.y - visualOffset;
+		renderer->resetRetainedStats();
+		for (int layer = 0; layer < maxRenderLayers; ++layer)
+		{
+			// every tap of a layer is drawn before the holds like when they shared a batch
+			for (const bool holds : { false, true })
+			{
+				for (const auto& [index, chunk] : noteLayer)
+				{
+					// no chunk has notes before its first tick
+					if (index * chunkTicks > lastTick)
+						break;
+
+					const RetainedGeometry& geometry = holds ? chunk.holds : chunk.taps;
+					if (!isChunkVisible(chunk) || std::none_of(geometry.ranges.begin(), geometry.ranges.end(),
+						[layer](const RetainedGeometry::Range& range) { return range.layer == layer; }))
+						continue;
+
+					shader->setMatrix4("view", DirectX::XMMatrixTranslation(laneOffset, baseY + tickToPosition(index * chunkTicks), 0.0f));
+					renderer->drawRetained(geometry, layer);
+				}
+			}
+		}
+	}
+
 	void ScoreEditorTimeline::previewPaste(ScoreContext& context, Renderer* renderer)
 	{
 		context.pasteData.offsetLane = std::clamp(hoverLane - context.pasteData.midLane,
@@ -757,7 +1018,7 @@ namespace MikuMikuWorld
 				drawNote(note, renderer, hoverTint, hoverTick, context.pasteData.offsetLane);
 
 		for (const auto& [_, hold] : context.pasteData.holds)
-			drawHoldNote(context.pasteData.notes, hold, renderer, hoverTint, hoverTick, context.pasteData.offsetLane);
+			drawHoldNote(context.pasteData.notes, hold, pasteHoldGeometry, renderer, hoverTint, hoverTick, context.pasteData.offsetLane);
 	}
 
 	void ScoreEditorTimeline::updateInputNotes(EditArgs& edit)
@@ -798,21 +1059,25 @@ namespace MikuMikuWorld
 				if (tempo.tick == hoverTick)
 					return;
 
-			Score prev = context.score;
+			History change("Insert BPM change");
+			change.recordTempoChanges(context.score);
 			context.score.tempoChanges.push_back({ hoverTick, edit.bpm });
 			Utilities::sort<Tempo>(context.score.tempoChanges, [](const Tempo& a, const Tempo& b) { return a.tick < b.tick; });
+			context.score.invalidateTempoMap();
 
-			context.pushHistory("Insert BPM change", prev, context.score);
+			context.pushHistory(change);
 		}
 		else if (currentMode == TimelineMode::InsertTimeSign)
 		{
-			int measure = accumulateMeasures(hoverTick, TICKS_PER_BEAT, context.score.timeSignatures);
+			int measure = context.score.getMeasureMap().ticksToMeasure(hoverTick);
 			if (context.score.timeSignatures.find(measure) != context.score.timeSignatures.end())
 				return;
 
-			Score prev = context.score;
+			History change("Insert time signature");
+			change.recordTimeSignatures(context.score);
 			context.score.timeSignatures[measure] = { measure, edit.timeSignatureNumerator, edit.timeSignatureDenominator };
-			context.pushHistory("Insert time signature", prev, context.score);
+			context.score.invalidateMeasureMap();
+			context.pushHistory(change);
 		}
 		else if (currentMode == TimelineMode::InsertHiSpeed)
 		{
@@ -820,9 +1085,10 @@ namespace MikuMikuWorld
 				if (hs.tick == hoverTick)
 					return;
 
-			Score prev = context.score;
+			History change("Insert hi-speed changes");
+			change.recordHiSpeedChanges(context.score);
 			context.score.hiSpeedChanges.push_back({ hoverTick, edit.hiSpeed });
-			context.pushHistory("Insert hi-speed changes", prev, context.score);
+			context.pushHistory(change);
 		}
 	}
 
@@ -924,26 +1190,28 @@ namespace MikuMikuWorld
 		float xt = laneToPosition(lane);
 		float yt = getNoteYPosFromTick(tick);
 
-		for (auto& [id, hold] : context.score.holdNotes)
+		const Score& score = context.score;
+
+		for (auto& [id, hold] : score.holdNotes)
 		{
-			const Note& start = context.score.notes.at(hold.start.ID);
-			const Note& end = context.score.notes.at(hold.end);
+			const Note& start = score.notes.at(hold.start.ID);
+			const Note& end = score.notes.at(hold.end);
 
 			if (hold.steps.size())
 			{
 				const HoldStep& mid1 = hold.steps[0];
-				if (isMouseInHoldPath(start, context.score.notes.at(mid1.ID), hold.start.ease, xt, yt))
+				if (isMouseInHoldPath(start, score.notes.at(mid1.ID), hold.start.ease, xt, yt))
 					return id;
 
 				for (int step = 0; step < hold.steps.size() - 1; ++step)
 				{
-					const Note& m1 = context.score.notes.at(hold.steps[step].ID);
-					const Note& m2 = context.score.notes.at(hold.steps[step + 1].ID);
+					const Note& m1 = score.notes.at(hold.steps[step].ID);
+					const Note& m2 = score.notes.at(hold.steps[step + 1].ID);
 					if (isMouseInHoldPath(m1, m2, hold.steps[step].ease, xt, yt))
 						return id;
 				}
 
-				const Note& lastMid = context.score.notes.at(hold.steps[hold.steps.size() - 1].ID);
+				const Note& lastMid = score.notes.at(hold.steps[hold.steps.size() - 1].ID);
 				if (isMouseInHoldPath(lastMid, end, hold.steps[hold.steps.size() - 1].ease, xt, yt))
 					return id;
 			}
@@ -968,7 +1236,7 @@ namespace MikuMikuWorld
 		// note clicked
 		if (ImGui::IsItemActivated())
 		{
-			prevUpdateScore = context.score;
+			noteEdit = History("Update notes");
 			ctrlMousePos = mousePos;
 			holdLane = hoverLane;
 			holdTick = hoverTick;
@@ -992,8 +1260,8 @@ namespace MikuMikuWorld
 				for (int id : sortHolds)
 				{
 					HoldNote& hold = context.score.holdNotes.at(id);
-					Note& start = context.score.notes.at(id);
-					Note& end = context.score.notes.at(hold.end);
+					NoteRef start = context.score.notes.at(id);
+					NoteRef end = context.score.notes.at(hold.end);
 
 					if (start.tick > end.tick)
 					{
@@ -1004,14 +1272,14 @@ namespace MikuMikuWorld
 					if (hold.steps.size())
 					{
 						// ensure hold steps are between the start and end
-						Note& firstMid = context.score.notes.at(hold.steps[0].ID);
+						NoteRef firstMid = context.score.notes.at(hold.steps[0].ID);
 						if (start.tick > firstMid.tick)
 						{
 							std::swap(start.tick, firstMid.tick);
 							std::swap(start.lane, firstMid.lane);
 						}
 
-						Note& lastMid = context.score.notes.at(hold.steps[hold.steps.size() - 1].ID);
+						NoteRef lastMid = context.score.notes.at(hold.steps[hold.steps.size() - 1].ID);
 						if (end.tick < lastMid.tick)
 						{
 							std::swap(end.tick, lastMid.tick);
@@ -1020,10 +1288,12 @@ namespace MikuMikuWorld
 					}
 
 					sortHoldSteps(context.score, hold);
-					skipUpdateAfterSortingSteps = true;
 				}
 
-				context.history.pushHistory("Update notes", prevUpdateScore, context.score);
+				context.score.invalidateNoteIndex();
+
+				noteEdit.commit(context.score);
+				context.history.pushHistory(noteEdit);
 				hasEdit = false;
 			}
 		}
@@ -1031,7 +1301,7 @@ namespace MikuMikuWorld
 		return false;
 	}
 
-	void ScoreEditorTimeline::updateNote(ScoreContext& context, Note& note)
+	void ScoreEditorTimeline::updateNote(ScoreContext& context, const Note& note)
 	{
 		const float btnPosY = position.y - tickToPosition(note.tick) + visualOffset - (notesHeight * 0.5f);
 		float btnPosX = laneToPosition(note.lane) + position.x - 2.0f;
@@ -1076,7 +1346,7 @@ namespace MikuMikuWorld
 				bool canResize = true;
 				for (int id : context.selectedNotes)
 				{
-					Note& n = context.score.notes.at(id);
+					NoteRef n = context.score.notes.at(id);
 					int newLane = n.lane + diff;
 					int newWidth = n.width - diff;
 
@@ -1091,9 +1361,12 @@ namespace MikuMikuWorld
 				{
 					ctrlMousePos.x = mousePos.x;
 					hasEdit = true;
+					noteLayerSelectionEdited = true;
+					context.score.invalidateNoteIndex();
+					context.recordSelection(noteEdit);
 					for (int id : context.selectedNotes)
 					{
-						Note& n = context.score.notes.at(id);
+						NoteRef n = context.score.notes.at(id);
 						n.width = std::clamp(n.width - diff, MIN_NOTE_WIDTH, MAX_NOTE_WIDTH);
 						n.lane = std::clamp(n.lane + diff, MIN_LANE, MAX_LANE - n.width + 1);
 					}
@@ -1120,7 +1393,7 @@ namespace MikuMikuWorld
 				bool canMove = true;
 				for (int id : context.selectedNotes)
 				{
-					Note& n = context.score.notes.at(id);
+					NoteRef n = context.score.notes.at(id);
 					int newLane = n.lane + diff;
 
 					if (newLane < MIN_LANE || newLane + n.width - 1 > MAX_LANE)
@@ -1133,9 +1406,12 @@ namespace MikuMikuWorld
 				if (canMove)
 				{
 					hasEdit = true;
+					noteLayerSelectionEdited = true;
+					context.score.invalidateNoteIndex();
+					context.recordSelection(noteEdit);
 					for (int id : context.selectedNotes)
 					{
-						Note& n = context.score.notes.at(id);
+						NoteRef n = context.score.notes.at(id);
 						n.lane = std::clamp(n.lane + diff, MIN_LANE, MAX_LANE - n.width + 1);
 					}
 				}
@@ -1150,7 +1426,7 @@ namespace MikuMikuWorld
 				bool canMove = true;
 				for (int id : context.selectedNotes)
 				{
-					Note& n = context.score.notes.at(id);
+					NoteRef n = context.score.notes.at(id);
 					int newTick = n.tick + diff;
 
 					if (newTick < 0)
@@ -1163,9 +1439,12 @@ namespace MikuMikuWorld
 				if (canMove)
 				{
 					hasEdit = true;
+					noteLayerSelectionEdited = true;
+					context.score.invalidateNoteIndex();
+					context.recordSelection(noteEdit);
 					for (int id : context.selectedNotes)
 					{
-						Note& n = context.score.notes.at(id);
+						NoteRef n = context.score.notes.at(id);
 						n.tick = std::max(n.tick + diff, 0);
 					}
 				}
@@ -1218,7 +1497,7 @@ namespace MikuMikuWorld
 				bool canResize = true;
 				for (int id : context.selectedNotes)
 				{
-					Note& n = context.score.notes.at(id);
+					NoteRef n = context.score.notes.at(id);
 					int newWidth = n.width + diff;
 
 					if (newWidth < MIN_NOTE_WIDTH || newWidth > MAX_NOTE_WIDTH)
@@ -1232,9 +1511,12 @@ namespace MikuMikuWorld
 				{
 					ctrlMousePos.x = mousePos.x;
 					hasEdit = true;
+					noteLayerSelectionEdited = true;
+					context.score.invalidateNoteIndex();
+					context.recordSelection(noteEdit);
 					for (int id : context.selectedNotes)
 					{
-						Note& n = context.score.notes.at(id);
+						NoteRef n = context.score.notes.at(id);
 						n.width = std::clamp(n.width + diff, MIN_NOTE_WIDTH, MAX_NOTE_WIDTH - n.lane);
 					}
 				}
@@ -1244,43 +1526,110 @@ namespace MikuMikuWorld
 		ImGui::PopID();
 	}
 
-	void ScoreEditorTimeline::drawHoldCurve(const Note& n1, const Note& n2, EaseType ease, Renderer* renderer, const Color& tint, const int offsetTick, const int offsetLane)
+	void ScoreEditorTimeline::tessellateHoldCurve(const Note& n1, const Note& n2, EaseType ease, HoldCurveSegment& segment) const
+	{
+		segment.critical = n1.critical;
+		segment.points.clear();
+
+		float steps = ease == EaseType::Linear ? 1 : std::max(5.0f, std::ceil(abs(tickToPosition(n2.tick - n1.tick)) / 10));
+		for (int y = 0; y <= steps; ++y)
+		{
+			const float percent = y / steps;
+			float i = ease == EaseType::Linear ? percent : ease == EaseType::EaseIn ? easeIn(percent) : easeOut(percent);
+
+			segment.points.push_back(HoldCurvePoint{
+				lerp(n1.tick, n2.tick, percent),
+				lerp(n1.lane, n2.lane, i),
+				lerp(n1.lane + n1.width, n2.lane + n2.width, i)
+			});
+		}
+	}
+
+	const ScoreEditorTimeline::HoldGeometry& ScoreEditorTimeline::getHoldGeometry(std::unordered_map<int, HoldGeometry>& cache, const NoteStore& notes, const HoldNote& hold)
+	{
+		auto appendKey = [this, &notes](int id)
+		{
+			const Note& note = notes.at(id);
+			holdKey.push_back(note.tick);
+			holdKey.push_back(note.lane);
+			holdKey.push_back(note.width);
+			holdKey.push_back(note.critical);
+		};
+
+		holdKey.clear();
+		holdKey.push_back((int)hold.start.ease);
+		appendKey(hold.start.ID);
+		for (const auto& step : hold.steps)
+		{
+			holdKey.push_back((int)step.type);
+			holdKey.push_back((int)step.ease);
+			appendKey(step.ID);
+		}
+		appendKey(hold.end);
+
+		HoldGeometry& geometry = cache[hold.start.ID];
+		if (geometry.zoom == zoom && geometry.key == holdKey)
+			return geometry;
+
+		geometry.key = holdKey;
+		geometry.zoom = zoom;
+		geometry.segments.clear();
+
+		const Note& start = notes.at(hold.start.ID);
+		const Note& end = notes.at(hold.end);
+
+		int s1 = -1;
+		for (int i = 0; i < hold.steps.size(); ++i)
+		{
+			if (hold.steps[i].type == HoldStepType::Skip)
+				continue;
+
+			const Note& n1 = s1 == -1 ? start : notes.at(hold.steps[s1].ID);
+			const Note& n2 = notes.at(hold.steps[i].ID);
+			const EaseType ease = s1 == -1 ? hold.start.ease : hold.steps[s1].ease;
+			tessellateHoldCurve(n1, n2, ease, geometry.segments.emplace_back());
+
+			s1 = i;
+		}
+
+		const Note& n1 = s1 == -1 ? start : notes.at(hold.steps[s1].ID);
+		const EaseType ease = s1 == -1 ? hold.start.ease : hold.steps[s1].ease;
+		tessellateHoldCurve(n1, end, ease, geometry.segments.emplace_back());
+
+		return geometry;
+	}
+
+	void ScoreEditorTimeline::drawHoldCurve(const HoldCurveSegment& segment, Renderer* renderer, const Color& tint, const int offsetTick, const int offsetLane)
 	{
-		int texIndex = n1.critical ? noteTextures.holdPath : noteTextures.criticalHoldPath;
+		int texIndex = segment.critical ? noteTextures.holdPath : noteTextures.criticalHoldPath;
 		if (texIndex == -1)
 			return;
 
 		const Texture& pathTex = ResourceManager::textures[texIndex];
+		const float tickHeight = unitHeight * zoom;
+		const float baseY = position.y - visualOffset + size.y;
 
-		float startX1 = laneToPosition(n1.lane + offsetLane);
-		float startX2 = laneToPosition(n1.lane + n1.width + offsetLane);
-		float startY = getNoteYPosFromTick(n1.tick + offsetTick);
-
-		float endX1 = laneToPosition(n2.lane + offsetLane);
-		float endX2 = laneToPosition(n2.lane + n2.width + offsetLane);
-		float endY = getNoteYPosFromTick(n2.tick + offsetTick);
-
-		float steps = ease == EaseType::Linear ? 1 : std::max(5.0f, std::ceilf(abs((endY - startY)) / 10));
-		for (int y = 0; y < steps; ++y)
+		for (int p = 1; p < segment.points.size(); ++p)
 		{
-			const float percent1 = y / steps;
-			const float percent2 = (y + 1) / steps;
-			float i1 = ease == EaseType::Linear ? percent1 : ease == EaseType::EaseIn ? easeIn(percent1) : easeOut(percent1);
-			float i2 = ease == EaseType::Linear ? percent2 : ease == EaseType::EaseIn ? easeIn(percent2) : easeOut(percent2);
+			const HoldCurvePoint& a = segment.points[p - 1];
+			const HoldCurvePoint& b = segment.points[p];
 
-			float xl1 = lerp(startX1, endX1, i1) - NOTES_SLICE_WIDTH;
-			float xr1 = lerp(startX2, endX2, i1) + NOTES_SLICE_WIDTH;
-			float y1 = lerp(startY, endY, percent1);
-			float y2 = lerp(startY, endY, percent2);
-			float xl2 = lerp(startX1, endX1, i2) - NOTES_SLICE_WIDTH;
-			float xr2 = lerp(startX2, endX2, i2) + NOTES_SLICE_WIDTH;
+			float y1 = baseY + (a.tick + offsetTick) * tickHeight;
+			float y2 = baseY + (b.tick + offsetTick) * tickHeight;
+			if (!recordingNoteLayer)
+			{
+				if (y2 <= 0)
+					continue;
 
-			if (y2 <= 0)
-				continue;
+				// rest of hold no longer visible
+				if (y1 > size.y + size.y + position.y + 100)
+					break;
+			}
 
-			// rest of hold no longer visible
-			if (y1 > size.y + size.y + position.y + 100)
-				break;
+			float xl1 = laneToPosition(a.left + offsetLane) - NOTES_SLICE_WIDTH;
+			float xr1 = laneToPosition(a.right + offsetLane) + NOTES_SLICE_WIDTH;
+			float xl2 = laneToPosition(b.left + offsetLane) - NOTES_SLICE_WIDTH;
+			float xr2 = laneToPosition(b.right + offsetLane) + NOTES_SLICE_WIDTH;
 
 			Vector2 p1{ xl1, y1 };
 			Vector2 p2{ xl1 + NOTES_SLICE_WIDTH, y1 };
@@ -1305,6 +1654,12 @@ namespace MikuMikuWorld
 		}
 	}
 
+	void ScoreEditorTimeline::drawHoldCurve(const Note& n1, const Note& n2, EaseType ease, Renderer* renderer, const Color& tint, const int offsetTick, const int offsetLane)
+	{
+		tessellateHoldCurve(n1, n2, ease, inputHoldCurve);
+		drawHoldCurve(inputHoldCurve, renderer, tint, offsetTick, offsetLane);
+	}
+
 	void ScoreEditorTimeline::drawInputNote(Renderer* renderer)
 	{
 		if (insertingHold)
@@ -1319,36 +1674,18 @@ namespace MikuMikuWorld
 		}
 	}
 
-	void ScoreEditorTimeline::drawHoldNote(const std::unordered_map<int, Note>& notes, const HoldNote& note, Renderer* renderer,
-		const Color& tint, const int offsetTicks, const int offsetLane)
+	void ScoreEditorTimeline::drawHoldNote(const NoteStore& notes, const HoldNote& note, std::unordered_map<int, HoldGeometry>& cache,
+		Renderer* renderer, const Color& tint, const int offsetTicks, const int offsetLane)
 	{
 		const Note& start = notes.at(note.start.ID);
 		const Note& end = notes.at(note.end);
+		for (const auto& segment : getHoldGeometry(cache, notes, note).segments)
+			drawHoldCurve(segment, renderer, tint, offsetTicks, offsetLane);
+
 		if (note.steps.size())
 		{
 			int s1 = -1;
-			int s2 = -1;
-
-			for (int i = 0; i < note.steps.size(); ++i)
-			{
-				HoldStepType type = note.steps[i].type;
-				if (type == HoldStepType::Skip) continue;
-
-				s2 = i;
-				const Note& n1 = s1 == -1 ? start : notes.at(note.steps[s1].ID);
-				const Note& n2 = s2 == -1 ? end : notes.at(note.steps[s2].ID);
-				const EaseType ease = s1 == -1 ? note.start.ease : note.steps[s1].ease;
-				drawHoldCurve(n1, n2, ease, renderer, tint, offsetTicks, offsetLane);
-
-				s1 = s2;
-			}
-
-			const Note& n1 = s1 == -1 ? start : notes.at(note.steps[s1].ID);
-			const EaseType ease = s1 == -1 ? note.start.ease : note.steps[s1].ease;
-			drawHoldCurve(n1, end, ease, renderer, tint, offsetTicks, offsetLane);
-
-			s1 = -1;
-			s2 = 1;
+			int s2 = 1;
 
 			if (noteTextures.notes == -1)
 				return;
@@ -1369,7 +1706,8 @@ namespace MikuMikuWorld
 
 				if (isNoteVisible(n3, offsetTicks))
 				{
-					if (drawHoldStepOutlines)
+					// outlines of the note layer's steps are collected every frame in updateNotes
+					if (drawHoldStepOutlines && !recordingNoteLayer)
 						drawSteps.emplace_back(StepDrawData{ n3.tick + offsetTicks, n3.lane + offsetLane, n3.width, note.steps[i].type });
 
 					if (note.steps[i].type != HoldStepType::Hidden)
@@ -1404,10 +1742,6 @@ namespace MikuMikuWorld
 					s1 = i;
 			}
 		}
-		else
-		{
-			drawHoldCurve(start, end, note.start.ease, renderer, tint, offsetTicks, offsetLane);
-		}
 
 		if (isNoteVisible(start, offsetTicks))
 			drawNote(start, renderer, tint, offsetTicks, offsetLane);
@@ -1605,10 +1939,12 @@ namespace MikuMikuWorld
 				UI::addFloatProperty(getString("bpm"), eventEdit.editBpm, "%g");
 				if (ImGui::IsItemDeactivatedAfterEdit())
 				{
-					Score prev = context.score;
+					History change("Change tempo");
+					change.recordTempoChanges(context.score);
 					tempo.bpm = std::clamp(eventEdit.editBpm, MIN_BPM, MAX_BPM);
+					context.score.invalidateTempoMap();
 
-					context.pushHistory("Change tempo", prev, context.score);
+					context.pushHistory(change);
 				}
 				UI::endPropertyColumns();
 
@@ -1619,9 +1955,11 @@ namespace MikuMikuWorld
 					if (ImGui::Button(getString("remove"), ImVec2(-1, UI::btnSmall.y + 2)))
 					{
 						ImGui::CloseCurrentPopup();
-						Score prev = context.score;
+						History change("Remove tempo change");
+						change.recordTempoChanges(context.score);
 						context.score.tempoChanges.erase(context.score.tempoChanges.begin() + eventEdit.editBpmIndex);
-						context.pushHistory("Remove tempo change", prev, context.score);
+						context.score.invalidateTempoMap();
+						context.pushHistory(change);
 					}
 				}
 			}
@@ -1630,12 +1968,14 @@ namespace MikuMikuWorld
 				UI::beginPropertyColumns();
 				if (UI::timeSignatureSelect(eventEdit.editTimeSignatureNumerator, eventEdit.editTimeSignatureDenominator))
 				{
-					Score prev = context.score;
+					History change("Change time signature");
+					change.recordTimeSignatures(context.score);
 					TimeSignature& ts = context.score.timeSignatures[eventEdit.editTimeSignatureIndex];
 					ts.numerator = std::clamp(abs(eventEdit.editTimeSignatureNumerator), MIN_TIME_SIGN, MAX_TIME_SIGN);
 					ts.denominator = std::clamp(abs(eventEdit.editTimeSignatureDenominator), MIN_TIME_SIGN, MAX_TIME_SIGN);
+					context.score.invalidateMeasureMap();
 
-					context.pushHistory("Change time signature", prev, context.score);
+					context.pushHistory(change);
 				}
 				UI::endPropertyColumns();
 
@@ -1646,9 +1986,11 @@ namespace MikuMikuWorld
 					if (ImGui::Button(getString("remove"), ImVec2(-1, UI::btnSmall.y + 2)))
 					{
 						ImGui::CloseCurrentPopup();
-						Score prev = context.score;
+						History change("Remove time signature");
+						change.recordTimeSignatures(context.score);
 						context.score.timeSignatures.erase(eventEdit.editTimeSignatureIndex);
-						context.pushHistory("Remove time signature", prev, context.score);
+						context.score.invalidateMeasureMap();
+						context.pushHistory(change);
 					}
 				}
 			}
@@ -1659,10 +2001,11 @@ namespace MikuMikuWorld
 				HiSpeedChange& hiSpeed = context.score.hiSpeedChanges[eventEdit.editHiSpeedIndex];
 				if (ImGui::IsItemDeactivatedAfterEdit())
 				{
-					Score prev = context.score;
+					History change("Change hi-speed");
+					change.recordHiSpeedChanges(context.score);
 					hiSpeed.speed = eventEdit.editHiSpeed;
 
-					context.pushHistory("Change hi-speed", prev, context.score);
+					context.pushHistory(change);
 				}
 				UI::endPropertyColumns();
 
@@ -1670,9 +2013,10 @@ namespace MikuMikuWorld
 				if (ImGui::Button(getString("remove"), ImVec2(-1, UI::btnSmall.y + 2)))
 				{
 					ImGui::CloseCurrentPopup();
-					Score prev = context.score;
+					History change("Remove hi-speed change");
+					change.recordHiSpeedChanges(context.score);
 					context.score.hiSpeedChanges.erase(context.score.hiSpeedChanges.begin() + eventEdit.editHiSpeedIndex);
-					context.pushHistory("Remove hi-speed change", prev, context.score);
+					context.pushHistory(change);
 				}
 			}
 			ImGui::EndPopup();
@@ -1718,18 +2062,19 @@ namespace MikuMikuWorld
 
 	void ScoreEditorTimeline::insertNote(ScoreContext& context, EditArgs& edit, bool critical)
 	{
-		Score prev = context.score;
+		History change("Insert note");
 
 		Note newNote = inputNotes.tap;
 		newNote.ID = nextID++;
 
+		change.recordNote(context.score, newNote.ID);
 		context.score.notes[newNote.ID] = newNote;
-		context.pushHistory("Insert note", prev, context.score);
+		context.pushHistory(change);
 	}
 
 	void ScoreEditorTimeline::insertHold(ScoreContext& context, EditArgs& edit)
 	{
-		Score prev = context.score;
+		History change("Insert hold");
 
 		Note holdStart = inputNotes.holdStart;
 		holdStart.ID = nextID++;
@@ -1740,13 +2085,8 @@ namespace MikuMikuWorld
 
 		if (holdStart.tick == holdEnd.tick)
 		{
-			const TimeSignature& t = context.score.timeSignatures.at(
-				findTimeSignature(
-					accumulateMeasures(
-						holdStart.tick, TICKS_PER_BEAT, context.score.timeSignatures
-					), context.score.timeSignatures
-				)
-			);
+			const MeasureMap& measureMap = context.score.getMeasureMap();
+			const TimeSignature& t = measureMap.getTimeSignature(measureMap.ticksToMeasure(holdStart.tick));
 
 			holdEnd.tick += (beatsPerMeasure(t) * TICKS_PER_BEAT) / (((float)division / 4) * t.numerator);
 		}
@@ -1755,10 +2095,14 @@ namespace MikuMikuWorld
 			std::swap(holdStart.tick, holdEnd.tick);
 		}
 
+		change.recordNote(context.score, holdStart.ID);
+		change.recordNote(context.score, holdEnd.ID);
+		change.recordHold(context.score, holdStart.ID);
+
 		context.score.notes[holdStart.ID] = holdStart;
 		context.score.notes[holdEnd.ID] = holdEnd;
 		context.score.holdNotes[holdStart.ID] = { {holdStart.ID, HoldStepType::Normal, edit.easeType}, {}, holdEnd.ID };
-		context.pushHistory("Insert hold", prev, context.score);
+		context.pushHistory(change);
 	}
 
 	void ScoreEditorTimeline::insertHoldStep(ScoreContext& context, EditArgs& edit, int holdId)
@@ -1771,7 +2115,8 @@ namespace MikuMikuWorld
 		if (context.score.notes.find(holdId) == context.score.notes.end())
 			return;
 
-		Score prev = context.score;
+		History change("Insert hold step");
+		change.recordHold(context.score, holdId);
 
 		HoldNote& hold = context.score.holdNotes[holdId];
 		Note holdStart = context.score.notes[holdId];
@@ -1781,13 +2126,14 @@ namespace MikuMikuWorld
 		holdStep.critical = holdStart.critical;
 		holdStep.parentID = holdStart.ID;
 
+		change.recordNote(context.score, holdStep.ID);
 		context.score.notes[holdStep.ID] = holdStep;
 
 		hold.steps.push_back({ holdStep.ID, edit.stepType, edit.easeType });
 
 		// sort steps in-case the step is inserted before/after existing steps
 		sortHoldSteps(context.score, hold);
-		context.pushHistory("Insert hold step", prev, context.score);
+		context.pushHistory(change);
 	}
 
 	void ScoreEditorTimeline::debug()
@@ -1856,65 +2202,77 @@ namespace MikuMikuWorld
 		offset = std::max(minOffset, tickToPosition(context.currentTick) + (size.y * (1.0f - config.cursorPositionThreshold)));
 	}
 
-	void ScoreEditorTimeline::updateNoteSE(ScoreContext& context)
+	void ScoreEditorTimeline::buildSoundSchedule(const Score& score)
 	{
-		if (!playing)
-			return;
+		soundSchedule.clear();
+		soundSchedule.reserve(score.notes.size() + score.holdNotes.size());
 
-		tickSEMap.clear();
-		for (const auto& it : context.score.notes)
+		const TempoMap& tempoMap = score.getTempoMap();
+		for (const auto& entry : score.notesInTickRange(INT_MIN, INT_MAX))
 		{
-			const Note& note = it.second;
-			float noteTime = accumulateDuration(note.tick, TICKS_PER_BEAT, context.score.tempoChanges);
-			float notePlayTime = noteTime - playStartTime;
-			float offsetNoteTime = noteTime - audioLookAhead;
+			const Note& note = score.notes.at(entry.ID);
+			const float noteTime = tempoMap.ticksToSeconds(note.tick);
 
-			if (offsetNoteTime >= timeLastFrame && offsetNoteTime < time)
+			const char* se = getNoteSE(note, score);
+			if (*se)
 			{
-				std::string se = getNoteSE(note, context.score);
-				std::string key = std::to_string(note.tick) + "-" + se;
-				if (se.size());
-				{
-					if (tickSEMap.find(key) == tickSEMap.end())
-					{
-						context.audio.playSound(se.c_str(), notePlayTime - audioOffsetCorrection, -1);
-						tickSEMap[key] = note.tick;
-					}
-				}
+				// notes on the same tick with the same sound effect only play it once
+				bool duplicate = false;
+				for (auto it = soundSchedule.rbegin(); it != soundSchedule.rend() && it->tick == note.tick; ++it)
+					duplicate |= it->endTime < 0 && it->se == se;
 
-				if (note.getType() == NoteType::Hold)
-				{
-					float endTime = accumulateDuration(context.score.notes.at(context.score.holdNotes.at(note.ID).end).tick, TICKS_PER_BEAT, context.score.tempoChanges);
-					context.audio.playSound(note.critical ? SE_CRITICAL_CONNECT : SE_CONNECT, notePlayTime - audioOffsetCorrection, endTime - playStartTime);
-				}
+				if (!duplicate)
+					soundSchedule.push_back({ noteTime, note.tick, se, -1.0f });
 			}
-			else if (time == playStartTime)
+
+			if (note.getType() == NoteType::Hold)
 			{
-				// playback just started
-				if (noteTime >= time && offsetNoteTime < time)
-				{
-					std::string se = getNoteSE(note, context.score);
-					std::string key = std::to_string(note.tick) + "-" + se;
-					if (se.size())
-					{
-						if (tickSEMap.find(key) == tickSEMap.end())
-						{
-							context.audio.playSound(se.c_str(), notePlayTime, -1);
-							tickSEMap[key] = note.tick;
-						}
-					}
-				}
+				int endTick = score.notes.at(score.holdNotes.at(note.ID).end).tick;
+				soundSchedule.push_back({ noteTime, note.tick, note.critical ? SE_CRITICAL_CONNECT : SE_CONNECT, tempoMap.ticksToSeconds(endTick) });
+			}
+		}
+	}
 
-				// playback started mid-hold
-				if (note.getType() == NoteType::Hold)
-				{
-					int endTick = context.score.notes.at(context.score.holdNotes.at(note.ID).end).tick;
-					float endTime = accumulateDuration(endTick, TICKS_PER_BEAT, context.score.tempoChanges);
+	void ScoreEditorTimeline::updateNoteSE(ScoreContext& context)
+	{
+		if (!playing)
+			return;
 
-					if ((noteTime - time) <= audioLookAhead && endTime > time)
-						context.audio.playSound(note.critical ? SE_CRITICAL_CONNECT : SE_CONNECT, std::max(0.0f, notePlayTime), endTime - playStartTime);
-				}
+		const bool justStarted = time == playStartTime;
+
+		// only sounds within the look ahead window of this frame are played
+		const float windowStart = justStarted ? time : timeLastFrame + audioLookAhead;
+		const float windowEnd = time + audioLookAhead;
+
+		if (justStarted || soundScheduleVersion != context.history.getVersion())
+		{
+			buildSoundSchedule(context.score);
+			soundScheduleVersion = context.history.getVersion();
+			soundCursor = std::lower_bound(soundSchedule.begin(), soundSchedule.end(), windowStart,
+				[](const SoundEvent& e, float t) { return e.time < t; }) - soundSchedule.begin();
+		}
+
+		if (justStarted)
+		{
+			// playback started mid-hold
+			for (size_t i = 0; i < soundCursor; ++i)
+			{
+				const SoundEvent& e = soundSchedule[i];
+				if (e.endTime > time)
+					context.audio.playSound(e.se, 0, e.endTime - playStartTime);
 			}
 		}
+
+		for (; soundCursor < soundSchedule.size() && soundSchedule[soundCursor].time < windowEnd; ++soundCursor)
+		{
+			const SoundEvent& e = soundSchedule[soundCursor];
+			float notePlayTime = e.time - playStartTime;
+
+			// sounds at playback start cannot be played early
+			if (!justStarted)
+				notePlayTime -= audioOffsetCorrection;
+
+			context.audio.playSound(e.se, notePlayTime, e.endTime < 0 ? -1 : e.endTime - playStartTime);
+		}
 	}
 }
@@ -4,6 +4,7 @@
 #include "Rendering/Camera.h"
 #include "Rendering/Framebuffer.h"
 #include "Rendering/Renderer.h"
+#include "Rendering/Shader.h"
 #include "TimelineMode.h"
 #include "Background.h"
 
@@ -37,7 +38,6 @@ namespace MikuMikuWorld
 		bool isHoveringNote;
 		bool isHoldingNote;
 		bool isMovingNote;
-		bool skipUpdateAfterSortingSteps;
 		bool dragging;
 		bool insertingHold;
 		bool hasEdit;
@@ -67,6 +67,67 @@ namespace MikuMikuWorld
 		
 		std::vector<StepDrawData> drawSteps;
 
+		// hold curves tessellated in tick and lane units so scrolling does not invalidate them
+		struct HoldCurvePoint
+		{
+			float tick;
+			float left;
+			float right;
+		};
+
+		struct HoldCurveSegment
+		{
+			bool critical;
+			std::vector<HoldCurvePoint> points;
+		};
+
+		struct HoldGeometry
+		{
+			// the control points the curves were built from
+			std::vector<int> key;
+			float zoom;
+			std::vector<HoldCurveSegment> segments;
+		};
+
+		std::unordered_map<int, HoldGeometry> holdGeometry;
+		std::unordered_map<int, HoldGeometry> pasteHoldGeometry;
+		std::vector<int> holdKey;
+		HoldCurveSegment inputHoldCurve;
+		int holdGeometryVersion{ -1 };
+
+		// notes and holds recorded once per range of ticks and kept in their own vertex buffers.
+		// a chunk is built with its first tick at y 0 and the first lane at x 0 and moved into place
+		// with the view matrix, so scrolling does not touch its vertices
+		struct NoteLayerChunk
+		{
+			// the note data the geometry was built from
+			std::vector<int> key;
+			std::vector<int> tapIDs;
+			std::vector<int> holdIDs;
+			int minTick;
+			int maxTick;
+			bool dirty;
+
+			// taps and holds are kept apart so every tap can be drawn before the holds of a layer
+			RetainedGeometry taps;
+			RetainedGeometry holds;
+		};
+
+		std::map<int, NoteLayerChunk> noteLayer;
+
+		// the chunk every tap and hold is in, so notes dragged in place can be moved between chunks
+		std::unordered_map<int, int> noteLayerTapChunks;
+		std::unordered_map<int, int> noteLayerHoldChunks;
+
+		// set when the selected notes are changed in place, which does not go through the history
+		bool noteLayerSelectionEdited{ false };
+		int noteLayerVersion{ -1 };
+		float noteLayerZoom{};
+		float noteLayerLaneWidth{};
+		float noteLayerNotesHeight{};
+		bool recordingNoteLayer{ false };
+		const int noteLayerChunkBeats = 16;
+
 		ImVec2 size;
 		ImVec2 position;
 		ImVec2 prevPos;
@@ -77,23 +138,44 @@ namespace MikuMikuWorld
 		ImVec2 dragStart;
 		ImVec2 mousePos;
 
-		Score prevUpdateScore;
+		History noteEdit;
 
 		Camera camera;
 		std::unique_ptr<Framebuffer> framebuffer;
-		std::unordered_map<std::string, int> tickSEMap;
+
+		struct SoundEvent
+		{
+			float time;
+			int tick;
+			const char* se;
+
+			// end time of hold connect sounds, negative for one-shot sounds
+			float endTime;
+		};
+
+		// every note sound effect sorted by time, rebuilt when playback starts or the score changes
+		std::vector<SoundEvent> soundSchedule;
+		size_t soundCursor{};
+		int soundScheduleVersion{ -1 };
 		const float audioOffsetCorrection = 0.02f;
 		const float audioLookAhead = 0.05f;
 
 		void updateScrollbar();
 		void updateScrollingPosition();
 
+		void tessellateHoldCurve(const Note& n1, const Note& n2, EaseType ease, HoldCurveSegment& segment) const;
+		const HoldGeometry& getHoldGeometry(std::unordered_map<int, HoldGeometry>& cache, const NoteStore& notes, const HoldNote& hold);
+		void drawHoldCurve(const HoldCurveSegment& segment, Renderer* renderer, const Color& tint, const int offsetTick = 0, const int offsetLane = 0);
 		void drawHoldCurve(const Note& n1, const Note& n2, EaseType ease, Renderer* renderer, const Color& tint, const int offsetTick = 0, const int offsetLane = 0);
-		void drawHoldNote(const std::unordered_map<int, Note>& notes, const HoldNote& note, Renderer* renderer, const Color& tint, const int offsetTicks = 0, const int offsetLane = 0);
+		void drawHoldNote(const NoteStore& notes, const HoldNote& note, std::unordered_map<int, HoldGeometry>& cache, Renderer* renderer, const Color& tint, const int offsetTicks = 0, const int offsetLane = 0);
 		void drawHoldMid(Note& note, HoldStepType type, Renderer* renderer, const Color& tint);
 		void drawOutline(const StepDrawData& data);
 		void drawFlickArrow(const Note& note, Renderer* renderer, const Color& tint, const int offsetTick = 0, const int offsetLane = 0);
 		void drawNote(const Note& note, Renderer* renderer, const Color& tint, const int offsetTick = 0, const int offsetLane = 0);
+		std::pair<int, int> getHoldTickRange(const Score& score, const HoldNote& hold) const;
+		void updateNoteLayer(const ScoreContext& context);
+		void updateNoteLayerSelection(const ScoreContext& context);
+		void drawNoteLayer(const Score& score, int firstTick, int lastTick, Shader* shader, Renderer* renderer);
 		bool noteControl(ScoreContext& context, const ImVec2& pos, const ImVec2& sz, const char* id, ImGuiMouseCursor cursor);
 		bool bpmControl(const Tempo& tempo);
 		bool bpmControl(float bpm, int tick, bool enabled);
@@ -116,6 +198,7 @@ namespace MikuMikuWorld
 		void insertHoldStep(ScoreContext& context, EditArgs& edit, int holdId);
 		void insertEvent(ScoreContext& context, EditArgs& edit);
 
+		void buildSoundSchedule(const Score& score);
 		void updateNoteSE(ScoreContext& context);
 
 		void contextMenu(ScoreContext& context);
@@ -168,7 +251,7 @@ namespace MikuMikuWorld
 
 		void update(ScoreContext& context, EditArgs& edit, Renderer* renderer);
 		void updateNotes(ScoreContext& context, EditArgs& edit, Renderer* renderer);
-		void updateNote(ScoreContext& context, Note& note);
+		void updateNote(ScoreContext& context, const Note& note);
 		void updateInputNotes(EditArgs& edit);
 		void debug();
 
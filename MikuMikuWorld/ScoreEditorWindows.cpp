@@ -528,6 +528,7 @@ namespace MikuMikuWorld
 						UI::addCheckboxProperty(getString("auto_save_enable"), config.autoSaveEnabled);
 						UI::addIntProperty(getString("auto_save_interval"), config.autoSaveInterval);
 						UI::addIntProperty(getString("auto_save_count"), config.autoSaveMaxCount);
+						UI::addCheckboxProperty(getString("edit_journal_enable"), config.editJournalEnabled);
 						UI::endPropertyColumns();
 					}
 
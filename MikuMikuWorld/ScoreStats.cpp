@@ -28,12 +28,17 @@ namespace MikuMikuWorld
 	void ScoreStats::calculateStats(const Score& score)
 	{
 		resetCounts();
-		for (const auto& [id, note] : score.notes)
+
+		const NoteStore& notes = score.notes;
+		for (int slot = 0; slot < notes.slotCount(); ++slot)
 		{
-			switch (note.getType())
+			if (!notes.isUsed(slot))
+				continue;
+
+			switch (notes.getType(slot))
 			{
 			case NoteType::Tap:
-				note.isFlick() ? ++flicks : ++taps;
+				notes.getFlick(slot) != FlickType::None ? ++flicks : ++taps;
 				break;
 
 			case NoteType::Hold:
@@ -45,7 +50,7 @@ namespace MikuMikuWorld
 				break;
 
 			case NoteType::HoldEnd:
-				if (note.isFlick())
+				if (notes.getFlick(slot) != FlickType::None)
 					++flicks;
 				break;
 
@@ -61,12 +66,17 @@ namespace MikuMikuWorld
 	void ScoreStats::calculateCombo(const Score& score)
 	{
 		resetCombo();
-		for (const auto& [id, note] : score.notes)
+
+		const NoteStore& notes = score.notes;
+		for (int slot = 0; slot < notes.slotCount(); ++slot)
 		{
-			if (note.getType() == NoteType::HoldMid)
+			if (!notes.isUsed(slot))
+				continue;
+
+			if (notes.getType(slot) == NoteType::HoldMid)
 			{
-				const HoldNote& hold = score.holdNotes.at(note.parentID);
-				int pos = findHoldStep(hold, note.ID);
+				const HoldNote& hold = score.holdNotes.at(notes.getParentID(slot));
+				int pos = findHoldStep(hold, notes.getID(slot));
 				if (pos != -1)
 					if (hold.steps[pos].type == HoldStepType::Hidden)
 						continue;
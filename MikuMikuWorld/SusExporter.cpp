@@ -9,26 +9,36 @@ using namespace IO;
 
 namespace MikuMikuWorld
 {
+	ChannelOverflowError::ChannelOverflowError(int _startTick, int _endTick)
+		: std::runtime_error(formatString("All %d slide channels are taken by slides overlapping the slide from tick %d to %d.", SUS_CHANNEL_COUNT, _startTick, _endTick)),
+		startTick{ _startTick }, endTick{ _endTick }
+	{
+	}
+
 	int ChannelProvider::generateChannel(int startTick, int endTick)
 	{
-		for (auto& it : channels)
+		while (!busyChannels.empty() && busyChannels.top().endTick < startTick)
 		{
-			int start = it.second.start;
-			int end = it.second.end;
-			if ((start == 0 && end == 0) || endTick < start || startTick > end)
-			{
-				channels[it.first] = TickRange{ startTick, endTick };
-				return it.first;
-			}
+			freeChannels.push(busyChannels.top().channel);
+			busyChannels.pop();
 		}
 
-		throw("No more channels available");
+		if (freeChannels.empty())
+			throw ChannelOverflowError(startTick, endTick);
+
+		int channel = freeChannels.top();
+		freeChannels.pop();
+		busyChannels.push({ endTick, channel });
+
+		return channel;
 	}
 
 	void ChannelProvider::clear()
 	{
-		for (int i = 0; i < 36; ++i)
-			channels[i] = TickRange{ 0, 0 };
+		freeChannels = {};
+		busyChannels = {};
+		for (int i = 0; i < SUS_CHANNEL_COUNT; ++i)
+			freeChannels.push(i);
 	}
 
 	SusExporter::SusExporter() : ticksPerBeat{ 480 }
@@ -36,69 +46,65 @@ namespace MikuMikuWorld
 
 	}
 
-	int SusExporter::getTicksFromMeasure(int measure)
+	const BarLengthTicks* SusExporter::findBarLength(int ticks) const
 	{
-		int barLengthIndex = 0;
-		for (int i = barLengthTicks.size() - 1; i >= 0; --i)
-		{
-			if (barLengthTicks[i].barLength.bar <= measure)
-				barLengthIndex = std::max(0, i);
-		}
+		auto it = std::upper_bound(barLengthTicks.begin(), barLengthTicks.end(), ticks,
+			[](int ticks, const BarLengthTicks& blt) { return ticks < blt.ticks; });
 
-		const BarLengthTicks& blt = barLengthTicks[barLengthIndex];
+		return it == barLengthTicks.begin() ? nullptr : &*std::prev(it);
+	}
+
+	int SusExporter::getTicksFromMeasure(int measure) const
+	{
+		// measures before the first bar length use the last one
+		auto it = std::upper_bound(barLengthTicks.begin(), barLengthTicks.end(), measure,
+			[](int measure, const BarLengthTicks& blt) { return measure < blt.barLength.bar; });
+
+		const BarLengthTicks& blt = it == barLengthTicks.begin() ? barLengthTicks.back() : *std::prev(it);
 		int measureDiff = measure - blt.barLength.bar;
 		int ticksPerMeasure = blt.barLength.length * ticksPerBeat;
 		return blt.ticks + (measureDiff * ticksPerMeasure);
 	}
 
-	int SusExporter::getMeasureFromTicks(int ticks)
+	int SusExporter::getMeasureFromTicks(int ticks) const
 	{
-		for (const auto& [barLength, barTicks] : barLengthTicks)
-		{
-			if (ticks >= barTicks)
-				return barLength.bar + ((float)(ticks - barTicks) / (float)ticksPerBeat / barLength.length);
-		}
+		const BarLengthTicks* blt = findBarLength(ticks);
+		if (!blt)
+			return 0; // no time signatures
 
-		// no time signatures
-		return 0;
+		return blt->barLength.bar + ((float)(ticks - blt->ticks) / (float)ticksPerBeat / blt->barLength.length);
 	}
 
-	void SusExporter::appendData(int tick, std::string info, std::string data)
+	void SusExporter::appendNote(const SUSNote& note, int type, int channel)
 	{
-		for (const auto& [barLength, barTicks] : barLengthTicks)
-		{
-			if (tick >= barTicks)
-			{
-				int currentMeasure = barLength.bar + ((float)(tick - barTicks) / (float)ticksPerBeat / barLength.length);
-				MeasureMap& measureMap = measuresMap[currentMeasure];
-				measureMap.measure = currentMeasure;
-
-				NoteMap& map = measureMap.notesMap[info];
-				map.data.push_back(NoteMap::RawData{ tick - barTicks, data });
-				map.ticksPerMeasure = barLength.length * ticksPerBeat;
-				break;
-			}
-		}
+		const BarLengthTicks* blt = findBarLength(note.tick);
+		if (!blt)
+			return;
+
+		int measure = blt->barLength.bar + ((float)(note.tick - blt->ticks) / (float)ticksPerBeat / blt->barLength.length);
+		int header = (type * 36 + note.lane) * 37 + channel + 1;
+		notes.push_back(SusNoteData{ measure, header, note.tick - blt->ticks, (int)(blt->barLength.length * ticksPerBeat),
+			{ digits[note.type], digits[note.width] } });
 	}
 
-	void SusExporter::appendNoteData(const SUSNote& note, const std::string infoPrefix, const std::string channel)
+	void SusExporter::writeMeasureBase(std::string& output, int measure, int& baseMeasure)
 	{
-		char buff1[10];
-		std::string info = infoPrefix + tostringBaseN(buff1, note.lane, 36);
-		if (channel != "-1")
-			info.append(channel);
-
-		char buff2[10];
-		appendData(note.tick, info, std::to_string(note.type) + tostringBaseN(buff2, note.width, 36));
+		int base = (measure / 1000) * 1000;
+		if (base != baseMeasure)
+		{
+			output.append("#MEASUREBS ").append(std::to_string(base)).append("\n");
+			baseMeasure = base;
+		}
 	}
 
-	void SusExporter::dump(const SUS& sus, const std::string& filename, std::string comment)
+	std::string SusExporter::dumpToString(const SUS& sus, std::string comment)
 	{
-		std::vector<std::string> lines;
+		// lines are written straight into the output so callers get the whole chart at once
+		std::string output;
 		if (comment.size())
 		{
 			// make sure the comment is ignored by parsers. 
-			lines.push_back(comment.substr(comment.find_first_not_of("#")));
+			output.append(comment.substr(comment.find_first_not_of("#"))).append("\n");
 		}
 
 		// write metadata
@@ -107,13 +113,11 @@ namespace MikuMikuWorld
 			std::string key = attrKey;
 			std::transform(key.begin(), key.end(), key.begin(), ::toupper);
 
-			lines.push_back("#" + key + " \"" + attrValue + "\"");
+			output.append("#").append(key).append(" \"").append(attrValue).append("\"\n");
 		}
 
-		lines.push_back(IO::formatString("#WAVEOFFSET %g", sus.metadata.waveOffset));
-		lines.push_back("");
-		lines.push_back(IO::formatString("#REQUEST \"ticks_per_beat %d\"", ticksPerBeat));
-		lines.push_back("");
+		output.append(IO::formatString("#WAVEOFFSET %g", sus.metadata.waveOffset)).append("\n\n");
+		output.append(IO::formatString("#REQUEST \"ticks_per_beat %d\"", ticksPerBeat)).append("\n\n");
 
 		auto barLengths = sus.barlengths;
 		std::stable_sort(barLengths.begin(), barLengths.end(),
@@ -131,11 +135,15 @@ namespace MikuMikuWorld
 		std::stable_sort(directionals.begin(), directionals.end(),
 			[](const SUSNote& a, const SUSNote& b) { return a.tick < b.tick; });
 
-		auto slides = sus.slides;
+		std::vector<const std::vector<SUSNote>*> slides;
+		slides.reserve(sus.slides.size());
+		for (const auto& slide : sus.slides)
+			slides.push_back(&slide);
+
 		std::stable_sort(slides.begin(), slides.end(),
-			[](const auto& a, const auto& b) { return a[0].tick < b[0].tick; });
+			[](const auto& a, const auto& b) { return (*a)[0].tick < (*b)[0].tick; });
 
-		measuresMap.clear();
+		notes.clear();
 		barLengthTicks.clear();
 		channelProvider.clear();
 		int baseMeasure = 0;
@@ -143,18 +151,11 @@ namespace MikuMikuWorld
 		// write time signatures
 		for (const auto& barLength : barLengths)
 		{
-			int base = (barLength.bar / 1000) * 1000;
-			int offset = barLength.bar % 1000;
-			if (base != baseMeasure)
-			{
-				lines.push_back("#MEASUREBS " + std::to_string(base));
-				baseMeasure = base;
-			}
-
-			lines.push_back(formatString("#%03d02: %g", offset, barLength.length));
+			writeMeasureBase(output, barLength.bar, baseMeasure);
+			output.append(formatString("#%03d02: %g", barLength.bar % 1000, barLength.length)).append("\n");
 		}
 
-		lines.push_back("");
+		output.append("\n");
 
 		int totalTicks = 0;
 		for (int i = 0; i < barLengths.size(); ++i)
@@ -168,8 +169,6 @@ namespace MikuMikuWorld
 			barLengthTicks.push_back({ barLengths[i], startTick });
 		}
 
-		std::reverse(barLengthTicks.begin(), barLengthTicks.end());
-
 		// write tempo changes
 		if (bpms.size() >= (36 * 36) - 1)
 		{
@@ -188,7 +187,7 @@ namespace MikuMikuWorld
 			if (bpmIdentifiers.find(bpm.bpm) == bpmIdentifiers.end())
 			{
 				bpmIdentifiers[bpm.bpm] = identifier;
-				lines.push_back(formatString("#BPM%s: %g", identifier.c_str(), bpm.bpm));
+				output.append(formatString("#BPM%s: %g", identifier.c_str(), bpm.bpm)).append("\n");
 			}
 		}
 
@@ -202,13 +201,7 @@ namespace MikuMikuWorld
 
 		for (const auto& [measure, bpms] : measuresBpms)
 		{
-			int base = (measure / 1000) * 1000;
-			int offset = measure % 1000;
-			if (base != baseMeasure)
-			{
-				lines.push_back("#MEASUREBS " + std::to_string(base));
-				baseMeasure = base;
-			}
+			writeMeasureBase(output, measure, baseMeasure);
 
 			int measureTicks = getTicksFromMeasure(measure);
 			int ticksPerMeasure = getTicksFromMeasure(measure + 1) - measureTicks;
@@ -228,10 +221,10 @@ namespace MikuMikuWorld
 				data[index + 1] = identifier[1];
 			}
 
-			lines.push_back(formatString("#%03d08: %s", offset, data.c_str()));
+			output.append(formatString("#%03d08: %s", measure % 1000, data.c_str())).append("\n");
 		}
 
-		lines.push_back("");
+		output.append("\n");
 
 		std::string speedLine = "\"";
 		for (int i = 0; i < sus.hiSpeeds.size(); ++i)
@@ -247,66 +240,93 @@ namespace MikuMikuWorld
 		}
 		speedLine.append("\"");
 		
-		lines.push_back(formatString("#TIL00: %s", speedLine.c_str()));
-		lines.push_back("#HISPEED 00");
-		lines.push_back("#MEASUREHS 00");
-		lines.push_back("");
+		output.append(formatString("#TIL00: %s", speedLine.c_str())).append("\n");
+		output.append("#HISPEED 00\n");
+		output.append("#MEASUREHS 00\n");
+		output.append("\n");
 
 		// prepare note data
+		size_t slideNoteCount = 0;
+		for (const auto& slide : sus.slides)
+			slideNoteCount += slide.size();
+
+		notes.reserve(taps.size() + directionals.size() + slideNoteCount);
 		for (const auto& tap : taps)
-			appendNoteData(tap, "1", "-1");
+			appendNote(tap, 1, -1);
 
 		for (const auto& directional : directionals)
-			appendNoteData(directional, "5", "-1");
+			appendNote(directional, 5, -1);
 
-		for (const auto& steps : slides)
+		for (const auto* steps : slides)
 		{
-			int startTick = steps[0].tick;
-			int endTick = steps[steps.size() - 1].tick;
+			int startTick = steps->front().tick;
+			int endTick = steps->back().tick;
 			int channel = channelProvider.generateChannel(startTick, endTick);
 
-			char buf[10]{};
-			std::string chStr(tostringBaseN(buf, channel, 36));
-			for (const auto& note : steps)
-				appendNoteData(note, "3", chStr);
+			for (const auto& note : *steps)
+				appendNote(note, 3, channel);
 		}
 
+		// one line per measure and header. notes at the same position keep the last one appended
+		std::stable_sort(notes.begin(), notes.end(), [](const SusNoteData& a, const SusNoteData& b)
+		{
+			return a.measure != b.measure ? a.measure < b.measure : a.header < b.header;
+		});
+
 		// write note data
-		for (const auto& [measure, map] : measuresMap)
+		std::string data;
+		for (auto line = notes.begin(); line != notes.end();)
 		{
-			int measureTicks = getTicksFromMeasure(measure);
-			int base = (measure / 1000) * 1000;
-			int offset = measure % 1000;
-			if (base != baseMeasure)
+			auto lineEnd = std::find_if(line, notes.end(), [line](const SusNoteData& note)
 			{
-				lines.push_back("#MEASUREBS " + std::to_string(base));
-				baseMeasure = base;
-			}
+				return note.measure != line->measure || note.header != line->header;
+			});
+
+			writeMeasureBase(output, line->measure, baseMeasure);
 
-			for (const auto& [info, notes] : map.notesMap)
+			int ticksPerMeasure = line->ticksPerMeasure;
+			int gcd = ticksPerMeasure;
+			for (auto note = line; note != lineEnd; ++note)
+				gcd = std::gcd(note->tick, gcd);
+
+			data.assign((ticksPerMeasure / gcd) * 2, '0');
+			for (auto note = line; note != lineEnd; ++note)
 			{
-				int gcd = notes.ticksPerMeasure;
-				for (const auto& raw : notes.data)
-					gcd = std::gcd(raw.tick, gcd);
-
-				int dataCount = notes.ticksPerMeasure / gcd;
-				std::string data(dataCount * 2, '0');
-				for (const auto& raw : notes.data)
-				{
-					int index = (raw.tick % notes.ticksPerMeasure) / gcd * 2;
-					data[index + 0] = raw.data[0];
-					data[index + 1] = raw.data[1];
-				}
-
-				lines.push_back(formatString("#%03d%s:", measure - baseMeasure, info.c_str()) + data);
+				int index = (note->tick % ticksPerMeasure) / gcd * 2;
+				data[index + 0] = note->data[0];
+				data[index + 1] = note->data[1];
 			}
+
+			int channel = line->header % 37 - 1;
+			int lane = line->header / 37 % 36;
+			int type = line->header / 37 / 36;
+
+			int offset = line->measure - baseMeasure;
+			output.push_back('#');
+			output.push_back('0' + offset / 100);
+			output.push_back('0' + offset / 10 % 10);
+			output.push_back('0' + offset % 10);
+			output.push_back(digits[type]);
+			output.push_back(digits[lane]);
+			if (channel != -1)
+				output.push_back(digits[channel]);
+
+			output.append(":").append(data).append("\n");
+			line = lineEnd;
 		}
 
+		return output;
+	}
+
+	void SusExporter::dump(const SUS& sus, const std::string& filename, std::string comment)
+	{
+		std::string output = dumpToString(sus, comment);
+
 		std::wstring wFilename = mbToWideStr(filename);
 		File susfile(wFilename, L"w");
 
-		susfile.writeAllLines(lines);
+		susfile.write(output);
 		susfile.flush();
 		susfile.close();
 	}
-}
\ No newline at end of file
+}
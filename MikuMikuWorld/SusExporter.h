@@ -3,14 +3,41 @@
 #include <map>
 #include <vector>
 #include <unordered_map>
+#include <queue>
+#include <stdexcept>
 
 namespace MikuMikuWorld
 {
+	constexpr int SUS_CHANNEL_COUNT = 36;
+
+	// thrown when more slides overlap than there are channels
+	class ChannelOverflowError : public std::runtime_error
+	{
+	public:
+		int startTick;
+		int endTick;
+
+		ChannelOverflowError(int startTick, int endTick);
+	};
+
+	// hands out slide channels to slides requested in order of their start tick.
+	// a channel is free again once the tick passes the end of its slide
 	class ChannelProvider
 	{
 	private:
-		struct TickRange { int start; int end; };
-		std::unordered_map<int, TickRange> channels;
+		struct BusyChannel
+		{
+			int endTick;
+			int channel;
+
+			inline bool operator>(const BusyChannel& other) const
+			{
+				return endTick != other.endTick ? endTick > other.endTick : channel > other.channel;
+			}
+		};
+
+		std::priority_queue<int, std::vector<int>, std::greater<int>> freeChannels;
+		std::priority_queue<BusyChannel, std::vector<BusyChannel>, std::greater<BusyChannel>> busyChannels;
 
 	public:
 		ChannelProvider()
@@ -24,22 +51,17 @@ namespace MikuMikuWorld
 
 	struct SUS;
 
-	struct NoteMap
+	struct SusNoteData
 	{
-		struct RawData
-		{
-			int tick;
-			std::string data;
-		};
+		int measure;
 
-		std::vector<RawData> data;
-		int ticksPerMeasure;
-	};
+		// note type, lane and slide channel packed so that sorting orders the lines like their headers
+		int header;
 
-	struct MeasureMap
-	{
-		int measure;
-		std::map<std::string, NoteMap> notesMap;
+		// relative to the start of the note's bar length
+		int tick;
+		int ticksPerMeasure;
+		char data[2];
 	};
 
 	struct BarLengthTicks
@@ -52,19 +74,28 @@ namespace MikuMikuWorld
 	{
 	private:
 		int ticksPerBeat;
-		std::map<int, MeasureMap> measuresMap;
+		std::vector<SusNoteData> notes;
+
+		// sorted by start tick
 		std::vector<BarLengthTicks> barLengthTicks;
 
 		ChannelProvider channelProvider;
 
-		int getMeasureFromTicks(int ticks);
-		int getTicksFromMeasure(int measure);
+		// the last bar length starting at or before the tick, or nullptr if there is none
+		const BarLengthTicks* findBarLength(int ticks) const;
+		int getMeasureFromTicks(int ticks) const;
+		int getTicksFromMeasure(int measure) const;
+
+		void appendNote(const SUSNote& note, int type, int channel);
+		void writeMeasureBase(std::string& output, int measure, int& baseMeasure);
 
 	public:
 		SusExporter();
 
-		void appendData(int tick, std::string info, std::string data);
-		void appendNoteData(const SUSNote& note, const std::string infoPrefix, const std::string channel);
+		/// <summary>
+		/// Returns the chart as the text dump would write to a file
+		/// </summary>
+		std::string dumpToString(const SUS& sus, std::string comment = "");
 		void dump(const SUS& sus, const std::string& filename, std::string comment = "");
 	};
 }
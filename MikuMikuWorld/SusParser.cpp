@@ -1,55 +1,156 @@
 #include "SusParser.h"
 #include "IO.h"
-#include "File.h"
+#include "BinaryReader.h"
+#include "WorkerPool.h"
+#include <array>
+#include <charconv>
 
 using namespace IO;
 
 namespace MikuMikuWorld
 {
-	SusParser::SusParser()
-		: ticksPerBeat{ 480 }, measureOffset{ 0 }, waveOffset{ 0 }
+	static constexpr std::array<int8_t, 256> makeBase36Table()
+	{
+		std::array<int8_t, 256> table{};
+		for (int i = 0; i < 256; ++i)
+			table[i] = -1;
+
+		for (int i = 0; i < 10; ++i)
+			table['0' + i] = i;
+
+		for (int i = 0; i < 26; ++i)
+		{
+			table['A' + i] = 10 + i;
+			table['a' + i] = 10 + i;
+		}
+
+		return table;
+	}
+
+	static constexpr std::array<int8_t, 256> base36Table = makeBase36Table();
+
+	static int base36Digit(char c)
+	{
+		int value = base36Table[(uint8_t)c];
+		if (value == -1)
+			throw std::runtime_error(std::string("Invalid base-36 digit '") + c + "'.");
+
+		return value;
+	}
+
+	// two digit IDs such as BPM definitions, or -1 if either digit is invalid
+	static int base36Pair(std::string_view str)
 	{
+		if (str.size() != 2 || base36Table[(uint8_t)str[0]] == -1 || base36Table[(uint8_t)str[1]] == -1)
+			return -1;
+
+		return base36Table[(uint8_t)str[0]] * 36 + base36Table[(uint8_t)str[1]];
 	}
 
-	bool SusParser::isCommand(const std::string& line)
+	// below this many lines per range the workers cost more than they save
+	constexpr size_t minNoteLinesPerRange = 256;
+
+	static std::string_view trimView(std::string_view str)
 	{
-		if (isDigit(line.substr(1, 1)))
+		size_t start = str.find_first_not_of(" \t\r");
+		if (start == std::string_view::npos)
+			return {};
+
+		size_t end = str.find_last_not_of(" \t\r");
+		return str.substr(start, end - start + 1);
+	}
+
+	static bool isDigits(std::string_view str)
+	{
+		if (str.size() && str[0] == '-')
+			str.remove_prefix(1);
+
+		if (!str.size())
 			return false;
 
-		// test for text value commands
-		if (line.find_first_of('"') != std::string::npos)
+		for (char c : str)
 		{
-			std::vector<std::string> lineSplit = split(line, " ");
-			if (lineSplit.size() < 2)
+			if (c < '0' || c > '9')
 				return false;
+		}
 
-			if (lineSplit[0].find_first_of(':') != std::string::npos)
-				return false;
+		return true;
+	}
 
-			int firstQuote = line.find_first_of('"');
-			int lastQuote = line.find_last_of('"');
-			return firstQuote != lastQuote && lastQuote != std::string::npos;
+	// like atoi and atof, leading spaces are skipped and anything after the number is ignored
+	static int parseInt(std::string_view str)
+	{
+		str = trimView(str);
+		if (str.size() && str[0] == '+')
+			str.remove_prefix(1);
+
+		int value = 0;
+		std::from_chars(str.data(), str.data() + str.size(), value);
+		return value;
+	}
+
+	static float parseFloat(std::string_view str)
+	{
+		str = trimView(str);
+		if (str.size() && str[0] == '+')
+			str.remove_prefix(1);
+
+		float value = 0;
+		std::from_chars(str.data(), str.data() + str.size(), value);
+		return value;
+	}
+
+	static bool equalsIgnoreCase(std::string_view a, std::string_view b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (toupper((uint8_t)a[i]) != toupper((uint8_t)b[i]))
+				return false;
 		}
 
-		return line.find_first_of(':') == std::string::npos;
+		return true;
 	}
 
-	int SusParser::toTicks(int measure, int i, int total)
+	SusParser::SusParser()
+		: ticksPerBeat{ 480 }, measureOffset{ 0 }, waveOffset{ 0 }
+	{
+	}
+
+	bool SusParser::isCommand(std::string_view line)
 	{
-		int bIndex = 0;
-		int accBarTicks = 0;
-		for (int i = 0; i < bars.size(); ++i)
+		if (line.size() > 1 && line[1] >= '0' && line[1] <= '9')
+			return false;
+
+		// test for text value commands
+		size_t firstQuote = line.find_first_of('"');
+		if (firstQuote != std::string_view::npos)
 		{
-			if (bars[i].measure > measure)
-				break;
+			size_t keyEnd = line.find_first_of(' ');
+			if (keyEnd == std::string_view::npos || keyEnd == line.size() - 1)
+				return false;
 
-			bIndex = i;
-			accBarTicks += bars[i].ticks;
+			if (line.substr(0, keyEnd).find_first_of(':') != std::string_view::npos)
+				return false;
+
+			return firstQuote != line.find_last_of('"');
 		}
 
-		return accBarTicks
-			+ ((measure - bars[bIndex].measure) * bars[bIndex].ticksPerMeasure)
-			+ ((i * bars[bIndex].ticksPerMeasure) / total);
+		return line.find_first_of(':') == std::string_view::npos;
+	}
+
+	int SusParser::toTicks(int measure, int i, int total) const
+	{
+		// the last bar starting at or before the measure. measures before the first bar extend it backwards
+		auto it = std::upper_bound(bars.begin(), bars.end(), measure,
+			[](int measure, const Bar& bar) { return measure < bar.measure; });
+
+		const Bar& bar = it == bars.begin() ? bars.front() : *std::prev(it);
+		return bar.ticks
+			+ ((measure - bar.measure) * bar.ticksPerMeasure)
+			+ ((i * bar.ticksPerMeasure) / total);
 	}
 
 	std::vector<std::vector<SUSNote>> SusParser::toSlides(const std::vector<SUSNote>& stream)
@@ -80,66 +181,111 @@ namespace MikuMikuWorld
 		return slides;
 	}
 
-	std::vector<SUSNote> SusParser::toNotes(const std::string& header, const std::string& data, int measureBase)
+	void SusParser::toNotes(std::string_view header, std::string_view data, int measureBase, std::vector<SUSNote>& notes) const
 	{
-		std::vector<SUSNote> notes;
-		int measure = measureBase + std::stoul(header.substr(0, 3).c_str(), nullptr, 10);
-		for (int i = 0; i < data.size(); i += 2)
+		int measure = measureBase + parseInt(header.substr(0, 3));
+		int lane = base36Digit(header[4]);
+		for (int i = 0; i + 1 < data.size(); i += 2)
 		{
 			// no data
-			if (data.substr(i, 2) == "00")
+			if (data[i] == '0' && data[i + 1] == '0')
 				continue;
 
-			notes.push_back(SUSNote{ toTicks(measure, i, data.size()),
-				(int)std::stoul(header.substr(4, 1), nullptr, 36),
-				(int)std::stoul(data.substr(i + 1, 1), nullptr, 36),
-				(int)std::stoul(data.substr(i, 1), nullptr, 36)
-			});
+			notes.push_back(SUSNote{ toTicks(measure, i, data.size()), lane, base36Digit(data[i + 1]), base36Digit(data[i]) });
 		}
-
-		return notes;
 	}
 
-	void SusParser::processCommand(std::string& line)
+	void SusParser::processCommand(std::string_view line)
 	{
-		int keyPos = line.find_first_of(' ');
-		if (keyPos == std::string::npos)
+		size_t keyPos = line.find_first_of(' ');
+		if (keyPos == std::string_view::npos)
 			return;
 
-		std::string key = line.substr(1, keyPos - 1);
-		std::string value = line.substr(keyPos + 1);
-
-		std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+		std::string_view key = line.substr(1, keyPos - 1);
+		std::string_view value = line.substr(keyPos + 1);
 
 		// exclude double quotes around the value
-		if (startsWith(value, "\"") && endsWith(value, "\""))
+		if (value.size() > 1 && value.front() == '"' && value.back() == '"')
 			value = value.substr(1, value.size() - 2);
 
-		if (key == "TITLE")
+		if (equalsIgnoreCase(key, "TITLE"))
 			title = value;
-		else if (key == "ARTIST")
+		else if (equalsIgnoreCase(key, "ARTIST"))
 			artist = value;
-		else if (key == "DESIGNER")
+		else if (equalsIgnoreCase(key, "DESIGNER"))
 			designer = value;
-		else if (key == "WAVEOFFSET")
-			waveOffset = atof(value.c_str());
-		else if (key == "MEASUREBS")
-			measureOffset = atoi(value.c_str());
-		else if (key == "REQUEST")
+		else if (equalsIgnoreCase(key, "WAVEOFFSET"))
+			waveOffset = parseFloat(value);
+		else if (equalsIgnoreCase(key, "MEASUREBS"))
+			measureOffset = parseInt(value);
+		else if (equalsIgnoreCase(key, "REQUEST"))
 		{
-			std::vector<std::string> requestArgs = split(value, " ");
-			if (requestArgs.size() == 2 && requestArgs[0] == "ticks_per_beat")
-				ticksPerBeat = atoi(requestArgs[1].c_str());
+			size_t separator = value.find_first_of(' ');
+			if (separator != std::string_view::npos && value.find_first_of(' ', separator + 1) == std::string_view::npos
+				&& value.substr(0, separator) == "ticks_per_beat")
+				ticksPerBeat = parseInt(value.substr(separator + 1));
+		}
+	}
+
+	void SusParser::decodeNoteLines(const SusLineData* begin, const SusLineData* end, SusNoteBuffer& buffer) const
+	{
+		for (const SusLineData* line = begin; line != end; ++line)
+		{
+			const std::string_view& header = line->header;
+			if (header.size() == 5 && header[3] == '1')
+			{
+				toNotes(header, line->data, line->measureOffset, buffer.taps);
+			}
+			else if (header.size() == 6 && header[3] == '3')
+			{
+				int channel = base36Digit(header[5]);
+				if (!buffer.streams.count(channel))
+					buffer.channels.push_back(channel);
+
+				toNotes(header, line->data, line->measureOffset, buffer.streams[channel]);
+			}
+			else if (header.size() == 5 && header[3] == '5')
+			{
+				toNotes(header, line->data, line->measureOffset, buffer.directionals);
+			}
 		}
 	}
 
+	std::vector<SusNoteBuffer> SusParser::decodeNoteLines(const std::vector<SusLineData>& lines) const
+	{
+		WorkerPool& pool = WorkerPool::shared();
+		size_t rangeCount = parallelDecoding ? std::min<size_t>(pool.getThreadCount() + 1, lines.size() / minNoteLinesPerRange) : 1;
+		std::vector<SusNoteBuffer> buffers(std::max<size_t>(rangeCount, 1));
+		if (rangeCount < 2)
+		{
+			decodeNoteLines(lines.data(), lines.data() + lines.size(), buffers[0]);
+			return buffers;
+		}
+
+		// each range of lines is decoded into its own buffer
+		pool.run(rangeCount, [this, &lines, &buffers, rangeCount](size_t i)
+		{
+			const SusLineData* begin = lines.data() + lines.size() * i / rangeCount;
+			const SusLineData* end = lines.data() + lines.size() * (i + 1) / rangeCount;
+			decodeNoteLines(begin, end, buffers[i]);
+		});
+
+		return buffers;
+	}
+
 	SUS SusParser::parse(const std::string& filename)
 	{
-		std::wstring wFilename = mbToWideStr(filename);
+		BinaryReader reader(filename);
+		if (!reader.isStreamValid())
+			throw std::runtime_error("Could not open " + filename + ".");
+
+		const std::vector<uint8_t>& buffer = reader.getData();
+		return parseText(std::string_view(reinterpret_cast<const char*>(buffer.data()), buffer.size()));
+	}
 
-		File susFile(wFilename, L"r");
-		auto lines = susFile.readAllLines();
-		susFile.close();
+	SUS SusParser::parseText(std::string_view text)
+	{
+		// lines, headers and data are views into the text for the rest of the parse
 
 		std::vector<SusLineData> noteLines;
 		std::vector<SusLineData> bpmLines;
@@ -148,10 +294,14 @@ namespace MikuMikuWorld
 		bpmDefinitions.clear();
 		measureOffset = 0;
 
-		for (int i = 0; i < lines.size(); ++i)
+		size_t lineStart = 0;
+		for (int i = 0; lineStart < text.size(); ++i)
 		{
-			std::string line = trim(lines[i]);
-			if (!startsWith(line, "#"))
+			size_t lineEnd = std::min(text.find_first_of('\n', lineStart), text.size());
+			std::string_view line = trimView(text.substr(lineStart, lineEnd - lineStart));
+			lineStart = lineEnd + 1;
+
+			if (!line.size() || line[0] != '#')
 				continue;
 
 			if (isCommand(line))
@@ -160,32 +310,36 @@ namespace MikuMikuWorld
 			}
 			else
 			{
-				auto l = split(line, ":");
-				if (l.size() < 2) // no ':' found
+				size_t separator = line.find_first_of(':');
+				if (separator == std::string_view::npos || separator == line.size() - 1) // no data after ':'
 					continue;
 
-				std::string header = trim(l[0]).substr(1);
-				std::string data = l.size() > 1 ? trim(l[1]) : "";
+				std::string_view header = trimView(line.substr(0, separator)).substr(1);
+				std::string_view fields = line.substr(separator + 1);
+				std::string_view data = trimView(fields.substr(0, fields.find_first_of(':')));
 
-				if (header.size() == 5 && header.substr(header.size() - 2) == "02" && isDigit(header))
+				if (header.size() == 5 && header.substr(3) == "02" && isDigits(header))
 				{
-					barLengths.push_back({ measureOffset + atoi(header.substr(0, 3).c_str()), (float)atof((data.c_str())) });
+					barLengths.push_back({ measureOffset + parseInt(header.substr(0, 3)), parseFloat(data) });
 				}
-				else if (header.size() == 5 && startsWith(header, "BPM"))
+				else if (header.size() == 5 && header.substr(0, 3) == "BPM")
 				{
-					bpmDefinitions[header.substr(3)] = atof(data.c_str());
+					int id = base36Pair(header.substr(3));
+					if (id != -1)
+						bpmDefinitions[id] = parseFloat(data);
 				}
-				else if (header.size() == 5 && header.substr(header.size() - 2, 2) == "08")
+				else if (header.size() == 5 && header.substr(3) == "08")
 				{
-					bpmLines.push_back({ i, measureOffset, line });
+					bpmLines.push_back({ i, measureOffset, header, data });
 				}
 				else if (header.size() == 5 && header.substr(0, 3) == "TIL")
 				{
-					hiSpeedLines.push_back({ i, measureOffset, line });
+					// speed changes are quoted and separated by commas and colons
+					hiSpeedLines.push_back({ i, measureOffset, header, fields });
 				}
 				else if (header.size() == 5 || header.size() == 6)
 				{
-					noteLines.push_back({ i, measureOffset, line });
+					noteLines.push_back({ i, measureOffset, header, data });
 				}
 			}
 		}
@@ -194,42 +348,41 @@ namespace MikuMikuWorld
 		if (!barLengths.size())
 			barLengths.push_back({ 0, 4.0f });
 
+		// bar lengths may appear in any order in the file but each bar starts where the previous one by measure ends
+		std::vector<BarLength> sortedBarLengths = barLengths;
+		std::stable_sort(sortedBarLengths.begin(), sortedBarLengths.end(),
+			[](const BarLength& b1, const BarLength& b2) { return b1.bar < b2.bar; });
+
 		int ticks = 0;
 		bars.clear();
-		bars.reserve(barLengths.size());
-		for (int i = 0; i < barLengths.size(); ++i)
+		bars.reserve(sortedBarLengths.size());
+		for (int i = 0; i < sortedBarLengths.size(); ++i)
 		{
-			int measure = barLengths[i].bar;
-			int ticksPerMeasure = barLengths[i].length * ticksPerBeat;
-			ticks = ticks + i == 0 ? 0 : (measure - barLengths[i - 1].bar) * barLengths[i - 1].length * ticksPerBeat;
+			int measure = sortedBarLengths[i].bar;
+			int ticksPerMeasure = sortedBarLengths[i].length * ticksPerBeat;
+			if (i > 0)
+				ticks += (int)((measure - sortedBarLengths[i - 1].bar) * sortedBarLengths[i - 1].length * ticksPerBeat);
 
 			bars.push_back(Bar{ measure, ticksPerMeasure, ticks });
 		}
-		std::sort(bars.begin(), bars.end(),
-			[](const Bar& b1, const Bar& b2) { return b1.measure < b2.measure; });
 
 		// process bpm changes
 		std::vector<BPM> bpms;
-		for (auto& line : bpmLines)
+		for (const auto& line : bpmLines)
 		{
-			auto l = split(line.line, ":");
-			if (l.size() < 2) // no ':' found
-				continue;
-
-			std::string header = trim(l[0]).substr(1);
-			std::string data = l.size() > 1 ? trim(l[1]) : "";
-
-			for (int i = 0; i < data.size(); i += 2)
+			int measure = line.measureOffset + parseInt(line.header.substr(0, 3));
+			for (int i = 0; i + 1 < line.data.size(); i += 2)
 			{
-				std::string subData = data.substr(i, 2);
+				std::string_view subData = line.data.substr(i, 2);
 				if (subData == "00")
 					continue;
 
-				int tick = toTicks(line.measureOffset + atoi(header.substr(0, 3).c_str()), i, data.size());
+				int tick = toTicks(measure, i, line.data.size());
 				float bpm = 120;
 
-				if (bpmDefinitions.find(subData) != bpmDefinitions.end())
-					bpm = bpmDefinitions[subData];
+				auto it = bpmDefinitions.find(base36Pair(subData));
+				if (it != bpmDefinitions.end())
+					bpm = it->second;
 
 				bpms.push_back({tick, bpm});
 			}
@@ -239,73 +392,46 @@ namespace MikuMikuWorld
 
 		// process hi-speed changes
 		std::vector<HiSpeed> hiSpeeds;
-		for (auto& line : hiSpeedLines)
+		for (const auto& line : hiSpeedLines)
 		{
-			std::string lineData = line.line;
-			int firstQuote = lineData.find_first_of('"') + 1;
-			int lastQuote = lineData.find_last_of('"');
-			
-			lineData = lineData.substr(firstQuote, lastQuote - firstQuote);
-			if (!lineData.size())
+			size_t firstQuote = line.data.find_first_of('"');
+			size_t lastQuote = line.data.find_last_of('"');
+			if (firstQuote == std::string_view::npos || lastQuote == firstQuote)
 				continue;
 
-			std::vector<std::string> speedChanges = split(lineData, ",");
-			for (const auto& change : speedChanges)
+			std::string_view lineData = line.data.substr(firstQuote + 1, lastQuote - firstQuote - 1);
+			while (lineData.size())
 			{
-				int measure = 0;
-				int tick = 0;
-				float speed = 1.0f;
-
-				int i1 = 0;
-				int i2 = 0;
-
-				i2 = change.find_first_of("'", i1);
-				measure = atoi(change.substr(i1, i2 - i1).c_str());
-
-				i1 = ++i2;
-				i2 = change.find_first_of(":", i2);
-				tick = atoi(change.substr(i1, i2 - i1).c_str());
-
-				i1 = ++i2;
-				speed = atof(change.substr(i1).c_str());
-
-				int measureTicks = toTicks(measure, 0, 1);
-				hiSpeeds.push_back({ measureTicks + tick, speed });
+				size_t changeEnd = std::min(lineData.find_first_of(','), lineData.size());
+				std::string_view change = lineData.substr(0, changeEnd);
+				lineData.remove_prefix(std::min(changeEnd + 1, lineData.size()));
+
+				// measure'tick:speed
+				std::string_view measure = change.substr(0, change.find_first_of('\''));
+				change.remove_prefix(std::min(measure.size() + 1, change.size()));
+				std::string_view tick = change.substr(0, change.find_first_of(':'));
+				change.remove_prefix(std::min(tick.size() + 1, change.size()));
+
+				int measureTicks = toTicks(parseInt(measure), 0, 1);
+				hiSpeeds.push_back({ measureTicks + parseInt(tick), parseFloat(change) });
 			}
 		}
 
 		std::stable_sort(hiSpeeds.begin(), hiSpeeds.end(),
 			[](const HiSpeed& a, const HiSpeed& b) {return a.tick < b.tick; });
 
-		// process notes
+		// process notes. merging the buffers in line order gives the same result as decoding serially
 		std::vector<SUSNote> taps;
 		std::vector<SUSNote> directionals;
 		std::unordered_map<int, std::vector<SUSNote>> streams;
-		for (auto& line : noteLines)
+		for (auto& buffer : decodeNoteLines(noteLines))
 		{
-			auto l = split(line.line, ":");
-			if (l.size() < 2) // no ':' found
-				continue;
-
-			std::string header = trim(l[0]).substr(1);
-			std::string data = l.size() > 1 ? trim(l[1]) : "";
-
-			if (header.size() == 5 && header[3] == '1')
-			{
-				std::vector<SUSNote> appendNotes = toNotes(header, data, line.measureOffset);
-				taps.insert(taps.end(), appendNotes.begin(), appendNotes.end());
-			}
-			else if (header.size() == 6 && header[3] == '3')
-			{
-				int channel = std::stoul(header.substr(5, 1), nullptr, 36);
-
-				std::vector<SUSNote> appendNotes = toNotes(header, data, line.measureOffset);
-				streams[channel].insert(streams[channel].end(), appendNotes.begin(), appendNotes.end());
-			}
-			else if (header.size() == 5 && header[3] == '5')
+			taps.insert(taps.end(), buffer.taps.begin(), buffer.taps.end());
+			directionals.insert(directionals.end(), buffer.directionals.begin(), buffer.directionals.end());
+			for (int channel : buffer.channels)
 			{
-				std::vector<SUSNote> appendNotes = toNotes(header, data, line.measureOffset);
-				directionals.insert(directionals.end(), appendNotes.begin(), appendNotes.end());
+				std::vector<SUSNote>& stream = streams[channel];
+				stream.insert(stream.end(), buffer.streams[channel].begin(), buffer.streams[channel].end());
 			}
 		}
 
@@ -1,15 +1,29 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <regex>
 #include "SUS.h"
 
 namespace MikuMikuWorld
 {
+	// header and data point into the file buffer held by SusParser::parse
 	struct SusLineData
 	{
 		int lineIndex;
 		int measureOffset;
-		std::string line;
+		std::string_view header;
+		std::string_view data;
+	};
+
+	// notes decoded from a contiguous range of note lines
+	struct SusNoteBuffer
+	{
+		std::vector<SUSNote> taps;
+		std::vector<SUSNote> directionals;
+		std::unordered_map<int, std::vector<SUSNote>> streams;
+
+		// slide channels in the order they first appear in the range
+		std::vector<int> channels;
 	};
 
 	struct SusLineArgs
@@ -27,18 +41,31 @@ namespace MikuMikuWorld
 		std::string title;
 		std::string artist;
 		std::string designer;
-		std::unordered_map<std::string, float> bpmDefinitions;
+		// keyed by the base-36 value of the definition's two digit ID
+		std::unordered_map<int, float> bpmDefinitions;
 		std::vector<Bar> bars;
+		bool parallelDecoding{ true };
 
-		bool isCommand(const std::string& line);
-		int toTicks(int measure, int i, int total);
+		bool isCommand(std::string_view line);
+		int toTicks(int measure, int i, int total) const;
 		std::vector<std::vector<SUSNote>> toSlides(const std::vector<SUSNote>& stream);
-		std::vector<SUSNote> toNotes(const std::string& header, const std::string& data, int measureBase);
+		void toNotes(std::string_view header, std::string_view data, int measureBase, std::vector<SUSNote>& notes) const;
+
+		// only reads the parser's state so ranges can be decoded on several threads at once
+		void decodeNoteLines(const SusLineData* begin, const SusLineData* end, SusNoteBuffer& buffer) const;
+		std::vector<SusNoteBuffer> decodeNoteLines(const std::vector<SusLineData>& lines) const;
 
 	public:
 		SusParser();
 
+		// note lines are decoded on the shared worker pool unless disabled.
+		// callers already parsing many files on their own threads should disable it
+		inline void setParallelDecoding(bool value) { parallelDecoding = value; }
+
 		SUS parse(const std::string& filename);
-		void processCommand(std::string& line);
+
+		// parses the contents of a SUS file already in memory
+		SUS parseText(std::string_view text);
+		void processCommand(std::string_view line);
 	};
 }
\ No newline at end of file
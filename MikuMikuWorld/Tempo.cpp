@@ -1,6 +1,7 @@
 #include "Tempo.h"
 #include "Score.h"
 #include "Constants.h"
+#include <algorithm>
 
 namespace MikuMikuWorld
 {
@@ -77,6 +78,113 @@ namespace MikuMikuWorld
 		return total;
 	}
 
+	void TempoMap::rebuild(const std::vector<Tempo>& _tempos, int _beatTicks)
+	{
+		tempos = _tempos;
+		beatTicks = _beatTicks;
+		if (tempos.empty())
+			tempos.push_back(Tempo());
+
+		seconds.resize(tempos.size());
+		seconds[0] = 0;
+		for (size_t i = 1; i < tempos.size(); ++i)
+			seconds[i] = seconds[i - 1] + ticksToSec(tempos[i].tick - tempos[i - 1].tick, beatTicks, tempos[i - 1].bpm);
+	}
+
+	float TempoMap::ticksToSeconds(int tick) const
+	{
+		// last tempo starting at or before the tick
+		auto it = std::upper_bound(tempos.begin(), tempos.end(), tick,
+			[](int t, const Tempo& tempo) { return t < tempo.tick; });
+
+		size_t index = it == tempos.begin() ? 0 : std::distance(tempos.begin(), it) - 1;
+		return seconds[index] + ticksToSec(tick - tempos[index].tick, beatTicks, tempos[index].bpm);
+	}
+
+	int TempoMap::secondsToTicks(float sec) const
+	{
+		// last tempo starting strictly before the time, matching accumulateTicks
+		auto it = std::lower_bound(seconds.begin(), seconds.end(), sec);
+
+		size_t index = it == seconds.begin() ? 0 : std::distance(seconds.begin(), it) - 1;
+		return tempos[index].tick + secsToTicks(sec - seconds[index], beatTicks, tempos[index].bpm);
+	}
+
+	void MeasureMap::rebuild(const std::map<int, TimeSignature>& ts, int _beatTicks)
+	{
+		beatTicks = _beatTicks;
+		segments.clear();
+		segments.reserve(std::max(ts.size(), (size_t)1));
+
+		int accTicks = 0;
+		for (const auto& [measure, signature] : ts)
+		{
+			if (segments.size())
+			{
+				const Segment& prev = segments.back();
+				accTicks += (measure - prev.timeSignature.measure) * prev.ticksPerMeasure;
+			}
+
+			segments.push_back({ accTicks, (int)(beatsPerMeasure(signature) * beatTicks), signature });
+		}
+
+		if (segments.empty())
+			segments.push_back({ 0, 4 * beatTicks, { 0, 4, 4 } });
+	}
+
+	const MeasureMap::Segment& MeasureMap::segmentAtMeasure(int measure) const
+	{
+		auto it = std::upper_bound(segments.begin(), segments.end(), measure,
+			[](int m, const Segment& segment) { return m < segment.timeSignature.measure; });
+
+		return it == segments.begin() ? segments.front() : *(it - 1);
+	}
+
+	int MeasureMap::ticksToMeasure(int tick) const
+	{
+		// last segment starting before the tick, matching accumulateMeasures
+		auto it = std::lower_bound(segments.begin(), segments.end(), tick,
+			[](const Segment& segment, int t) { return segment.tick < t; });
+
+		const Segment& segment = it == segments.begin() ? segments.front() : *(it - 1);
+		int total = segment.timeSignature.measure;
+		total += (tick - segment.tick) / (beatsPerMeasure(segment.timeSignature) * beatTicks);
+		return total;
+	}
+
+	int MeasureMap::measureToTicks(int measure) const
+	{
+		// last segment starting before the measure, matching measureToTicks
+		auto it = std::lower_bound(segments.begin(), segments.end(), measure,
+			[](const Segment& segment, int m) { return segment.timeSignature.measure < m; });
+
+		const Segment& segment = it == segments.begin() ? segments.front() : *(it - 1);
+		int total = segment.tick;
+		total += (measure - segment.timeSignature.measure) * (beatsPerMeasure(segment.timeSignature) * beatTicks);
+		return total;
+	}
+
+	const TimeSignature& MeasureMap::getTimeSignature(int measure) const
+	{
+		return segmentAtMeasure(measure).timeSignature;
+	}
+
+	int MeasureMap::snapTick(int tick, int div) const
+	{
+		const TimeSignature& t = getTimeSignature(ticksToMeasure(tick));
+
+		int subDiv = (beatsPerMeasure(t) * beatTicks) / (((float)div / 4.0f) * t.numerator);
+		int half = subDiv / 2;
+		int remaining = tick % subDiv;
+
+		// round to closest division
+		tick -= remaining;
+		if (remaining >= half)
+			tick += half * 2;
+
+		return std::max(tick, 0);
+	}
+
 	int accumulateMeasures(int tick, int beatTicks, const std::map<int, TimeSignature>& ts)
 	{
 		std::vector<TimeSignature> signatures;
@@ -22,6 +22,50 @@ namespace MikuMikuWorld
 		Tempo(int tick, float bpm);
 	};
 
+	// precomputed seconds at every tempo change for O(log n) tick <-> second conversion.
+	// must be rebuilt whenever the tempo changes it was built from are edited
+	class TempoMap
+	{
+	private:
+		std::vector<Tempo> tempos;
+		std::vector<float> seconds;
+		int beatTicks{ 480 };
+
+	public:
+		void rebuild(const std::vector<Tempo>& tempos, int beatTicks);
+
+		float ticksToSeconds(int tick) const;
+		int secondsToTicks(float sec) const;
+	};
+
+	// cumulative ticks at the start of every time signature for O(log n) tick <-> measure conversion.
+	// must be rebuilt whenever the time signatures it was built from are edited
+	class MeasureMap
+	{
+	private:
+		struct Segment
+		{
+			int tick;
+			int ticksPerMeasure;
+			TimeSignature timeSignature;
+		};
+
+		std::vector<Segment> segments;
+		int beatTicks{ 480 };
+
+		const Segment& segmentAtMeasure(int measure) const;
+
+	public:
+		void rebuild(const std::map<int, TimeSignature>& ts, int beatTicks);
+
+		int ticksToMeasure(int tick) const;
+		int measureToTicks(int measure) const;
+
+		// the time signature in effect at the given measure
+		const TimeSignature& getTimeSignature(int measure) const;
+		int snapTick(int tick, int div) const;
+	};
+
 	int snapTick(int tick, int div, const std::map<int, TimeSignature>& ts);
 	float beatsPerMeasure(const TimeSignature& t);
 
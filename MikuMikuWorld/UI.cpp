@@ -440,7 +440,9 @@ namespace MikuMikuWorld
 			ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImGui::GetStyle().Colors[ImGuiCol_TabActive]);
 		}
 
-		bool activated = ImGui::ImageButton(lblId.c_str(), (void*)ResourceManager::textures[texIndex].getID(), ImVec2{ UI::toolbarBtnSize.x - 4, UI::toolbarBtnSize.y - 4 });
+		const Texture& tex = ResourceManager::textures[texIndex];
+		bool activated = ImGui::ImageButton(lblId.c_str(), (void*)tex.getID(), ImVec2{ UI::toolbarBtnSize.x - 4, UI::toolbarBtnSize.y - 4 },
+			ImVec2{ tex.getU(0), tex.getV(0) }, ImVec2{ tex.getU(tex.getWidth()), tex.getV(tex.getHeight()) });
 		
 		std::string tooltipLabel = label;
 		if (shortcut && strlen(shortcut))
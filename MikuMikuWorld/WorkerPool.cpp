@@ -0,0 +1,117 @@
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace MikuMikuWorld
+{
+	struct WorkerPool::Job
+	{
+		std::function<void(size_t)> task;
+		size_t count;
+		std::atomic<size_t> next{ 0 };
+
+		std::mutex mutex;
+		std::condition_variable condition;
+		size_t finished{ 0 };
+		std::exception_ptr error;
+
+		// runs indices until none are left
+		void runAll()
+		{
+			for (size_t i = next++; i < count; i = next++)
+			{
+				std::exception_ptr taskError;
+				try
+				{
+					task(i);
+				}
+				catch (...)
+				{
+					taskError = std::current_exception();
+				}
+
+				std::lock_guard<std::mutex> lock{ mutex };
+				if (taskError && !error)
+					error = taskError;
+
+				if (++finished == count)
+					condition.notify_all();
+			}
+		}
+	};
+
+	WorkerPool::WorkerPool(int _threadCount)
+	{
+		for (int i = 0; i < _threadCount; ++i)
+			workers.emplace_back(&WorkerPool::work, this);
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+
+		condition.notify_all();
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	void WorkerPool::work()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				condition.wait(lock, [this] { return stopping || tasks.size(); });
+				if (stopping && tasks.empty())
+					return;
+
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	void WorkerPool::run(size_t count, const std::function<void(size_t)>& task)
+	{
+		if (!count)
+			return;
+
+		// workers that pick the job up late only find it drained, so they must not outlive it
+		std::shared_ptr<Job> job = std::make_shared<Job>();
+		job->task = task;
+		job->count = count;
+
+		size_t helpers = std::min<size_t>(workers.size(), count - 1);
+		if (helpers)
+		{
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				for (size_t i = 0; i < helpers; ++i)
+					tasks.push_back([job] { job->runAll(); });
+			}
+
+			condition.notify_all();
+		}
+
+		job->runAll();
+
+		std::unique_lock<std::mutex> lock{ job->mutex };
+		job->condition.wait(lock, [&job] { return job->finished == job->count; });
+		if (job->error)
+			std::rethrow_exception(job->error);
+	}
+
+	WorkerPool& WorkerPool::shared()
+	{
+		static WorkerPool pool(std::max<int>(std::thread::hardware_concurrency(), 1) - 1);
+		return pool;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MikuMikuWorld
+{
+	// a fixed set of threads kept alive between jobs so short parallel loops
+	// do not pay for starting and joining threads every time
+	class WorkerPool
+	{
+	private:
+		struct Job;
+
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool stopping{ false };
+
+		void work();
+
+	public:
+		WorkerPool(int _threadCount);
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+		~WorkerPool();
+
+		inline int getThreadCount() const { return workers.size(); }
+
+		/// <summary>
+		/// Calls task with every index below count and returns once all calls finished.
+		/// the calling thread takes part, so the job completes even when every worker is busy.
+		/// the first exception thrown by a task is rethrown
+		/// </summary>
+		void run(size_t count, const std::function<void(size_t)>& task);
+
+		/// <summary>
+		/// The pool shared by the whole process, with one thread less than the hardware has
+		/// </summary>
+		static WorkerPool& shared();
+	};
+}
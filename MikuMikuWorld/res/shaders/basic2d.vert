@@ -1,6 +1,6 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec2 aPos;
 layout (location = 1) in vec4 aColor;
 layout (location = 2) in vec2 aUV1;
 
@@ -14,5 +14,5 @@ void main()
 {
     uv1         = aUV1;
     color       = aColor;
-    gl_Position = projection * vec4(aPos, 1.0);
+    gl_Position = projection * view * vec4(aPos, 0.0, 1.0);
 }
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include "Score.h"
 #include "Tempo.h"
 #include "Constants.h"
+#include "SusParser.h"
+#include "SUS.h"
+#include "SusExporter.h"
+#include "Rendering/TextureAtlas.h"
+#include <algorithm>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 namespace mmw = MikuMikuWorld;
@@ -21,4 +26,262 @@ namespace ScoreTests
 			Assert::AreSame(tempos[1], target);
 		}
 	};
+
+	TEST_CLASS(SusParserTests)
+	{
+	public:
+
+		// odd meters listed out of order; every expected tick is worked out by hand from the bar table:
+		// measure 0: 1920 per measure, 3: 2400, 5: 1200 and 7: 3360 (with measure 2 at 1440)
+		TEST_METHOD(BarLengthChangesGolden)
+		{
+			const char* chart =
+				"#REQUEST \"ticks_per_beat 480\"\n"
+				"#00002: 4\n"
+				"#00502: 2.5\n"
+				"#00202: 3\n"
+				"#00302: 5\n"
+				"#00702: 7\n"
+				"#BPM01: 200\n"
+				"#00308: 0001\n"
+				"#TIL00: \"5'120:2.0\"\n"
+				"#00110:1300\n"
+				"#00212:00001400\n"
+				"#00413:0015\n"
+				"#00614:1500\n"
+				"#00915:000016\n";
+
+			mmw::SusParser parser;
+			mmw::SUS sus = parser.parseText(chart);
+
+			std::vector<int> expected{ 1920, 3840 + 720, 7680 + 1200, 11280, 19200 + 2240 };
+			Assert::AreEqual(expected.size(), sus.taps.size());
+			for (size_t i = 0; i < expected.size(); ++i)
+				Assert::AreEqual(expected[i], sus.taps[i].tick);
+
+			Assert::AreEqual(1, (int)sus.bpms.size());
+			Assert::AreEqual(6480, sus.bpms[0].tick);
+			Assert::AreEqual(200.0f, sus.bpms[0].bpm);
+
+			Assert::AreEqual(1, (int)sus.hiSpeeds.size());
+			Assert::AreEqual(10200, sus.hiSpeeds[0].tick);
+		}
+
+		// a bar length change on every measure, checked against a running sum of measure lengths
+		TEST_METHOD(ManyBarLengthChanges)
+		{
+			const float lengths[] = { 4.0f, 3.0f, 2.5f, 7.0f, 1.75f };
+			std::string chart = "#REQUEST \"ticks_per_beat 480\"\n";
+			std::vector<int> expected;
+
+			int measureStart = 0;
+			for (int measure = 0; measure < 500; ++measure)
+			{
+				float length = lengths[measure % 5];
+				int ticksPerMeasure = length * 480;
+
+				char line[64];
+				snprintf(line, sizeof(line), "#%03d02: %g\n#%03d10:00001300\n", measure, length, measure);
+				chart.append(line);
+
+				expected.push_back(measureStart + (4 * ticksPerMeasure) / 8);
+				measureStart += ticksPerMeasure;
+			}
+
+			mmw::SusParser parser;
+			mmw::SUS sus = parser.parseText(chart);
+
+			Assert::AreEqual(expected.size(), sus.taps.size());
+			for (size_t i = 0; i < expected.size(); ++i)
+				Assert::AreEqual(expected[i], sus.taps[i].tick);
+		}
+
+		// without any bar lengths every measure is 4 beats long
+		TEST_METHOD(DefaultBarLength)
+		{
+			mmw::SusParser parser;
+			mmw::SUS sus = parser.parseText("#01010:13\n#00210:0013\n");
+
+			Assert::AreEqual(2, (int)sus.taps.size());
+			Assert::AreEqual(19200, sus.taps[0].tick);
+			Assert::AreEqual(3840 + 960, sus.taps[1].tick);
+		}
+	};
+
+	TEST_CLASS(SusExporterTests)
+	{
+	public:
+
+		// the measure 1002 tap needs a #MEASUREBS line, and the headers pack type, lane and channel
+		// so the lines of measure 0 come out as tap, slide, then directional
+		TEST_METHOD(ExportGolden)
+		{
+			mmw::SUS sus;
+			sus.barlengths = { { 1000, 3 }, { 0, 4 } };
+			sus.bpms = { { 0, 120 } };
+			sus.taps = { { 1920000 + 2880 + 720, 10, 3, 1 }, { 480, 2, 3, 1 } };
+			sus.directionals = { { 960, 4, 2, 1 } };
+			sus.slides = { { { 0, 6, 2, 1 }, { 960, 6, 2, 3 }, { 1920, 6, 2, 2 } } };
+
+			mmw::SusExporter exporter;
+			std::string output = exporter.dumpToString(sus);
+
+			const char* expected =
+				"#WAVEOFFSET 0\n"
+				"\n"
+				"#REQUEST \"ticks_per_beat 480\"\n"
+				"\n"
+				"#00002: 4\n"
+				"#MEASUREBS 1000\n"
+				"#00002: 3\n"
+				"\n"
+				"#BPM01: 120\n"
+				"#MEASUREBS 0\n"
+				"#00008: 01\n"
+				"\n"
+				"#TIL00: \"\"\n"
+				"#HISPEED 00\n"
+				"#MEASUREHS 00\n"
+				"\n"
+				"#00012:00130000\n"
+				"#000360:1232\n"
+				"#00054:0012\n"
+				"#001360:22\n"
+				"#MEASUREBS 1000\n"
+				"#0021a:0013\n";
+
+			Assert::AreEqual(std::string(expected), output);
+
+			// the parser reads the same ticks back
+			mmw::SusParser parser;
+			mmw::SUS parsed = parser.parseText(output);
+
+			Assert::AreEqual(2, (int)parsed.taps.size());
+			Assert::AreEqual(480, parsed.taps[0].tick);
+			Assert::AreEqual(1920000 + 2880 + 720, parsed.taps[1].tick);
+			Assert::AreEqual(10, parsed.taps[1].lane);
+
+			Assert::AreEqual(1, (int)parsed.directionals.size());
+			Assert::AreEqual(960, parsed.directionals[0].tick);
+
+			Assert::AreEqual(1, (int)parsed.slides.size());
+			Assert::AreEqual(3, (int)parsed.slides[0].size());
+			Assert::AreEqual(1920, parsed.slides[0][2].tick);
+		}
+	};
+
+	TEST_CLASS(TextureAtlasTests)
+	{
+	public:
+
+		// the timeline's note, hold path and toolbar icon images
+		std::vector<mmw::AtlasRegion> timelineRegions()
+		{
+			std::vector<mmw::AtlasRegion> regions{ { 1968, 1170 }, { 448, 32 }, { 448, 32 } };
+			for (int i = 0; i < 13; ++i)
+				regions.push_back({ 64, 64 });
+
+			return regions;
+		}
+
+		void assertPadded(const std::vector<mmw::AtlasRegion>& regions, const std::vector<mmw::AtlasPage>& pages, int padding)
+		{
+			for (size_t i = 0; i < regions.size(); ++i)
+			{
+				const mmw::AtlasRegion& a = regions[i];
+				Assert::IsTrue(a.page >= 0 && a.page < (int)pages.size());
+				Assert::IsTrue(a.x >= padding && a.y >= padding);
+				Assert::IsTrue(a.x + a.width + padding <= pages[a.page].width);
+				Assert::IsTrue(a.y + a.height + padding <= pages[a.page].height);
+
+				// padding on both regions means at least twice the padding between them
+				for (size_t j = i + 1; j < regions.size(); ++j)
+				{
+					const mmw::AtlasRegion& b = regions[j];
+					if (a.page != b.page)
+						continue;
+
+					bool apart = a.x + a.width + padding * 2 <= b.x || b.x + b.width + padding * 2 <= a.x
+						|| a.y + a.height + padding * 2 <= b.y || b.y + b.height + padding * 2 <= a.y;
+					Assert::IsTrue(apart);
+				}
+			}
+		}
+
+		TEST_METHOD(TimelineImagesFitOnePage)
+		{
+			std::vector<mmw::AtlasRegion> regions = timelineRegions();
+			std::vector<mmw::AtlasPage> pages = mmw::AtlasPacker(4096, 8).pack(regions);
+
+			Assert::AreEqual(1, (int)pages.size());
+			assertPadded(regions, pages, 8);
+		}
+
+		// small pages force the regions onto several rows and pages
+		TEST_METHOD(NoOverlapAcrossPages)
+		{
+			std::vector<mmw::AtlasRegion> regions;
+			for (int i = 0; i < 200; ++i)
+				regions.push_back({ 10 + (i * 37) % 90, 5 + (i * 53) % 120 });
+
+			std::vector<mmw::AtlasPage> pages = mmw::AtlasPacker(256, 3).pack(regions);
+
+			Assert::IsTrue(pages.size() > 1);
+			assertPadded(regions, pages, 3);
+			for (const auto& page : pages)
+				Assert::IsTrue(page.width <= 256 && page.height <= 256);
+		}
+
+		TEST_METHOD(RegionTooLarge)
+		{
+			std::vector<mmw::AtlasRegion> regions{ { 250, 10 } };
+			bool thrown = false;
+			try
+			{
+				mmw::AtlasPacker(256, 4).pack(regions);
+			}
+			catch (std::runtime_error&)
+			{
+				thrown = true;
+			}
+
+			Assert::IsTrue(thrown);
+		}
+
+		// the padding around a blitted image repeats its nearest edge pixel
+		TEST_METHOD(BlitExtendsEdges)
+		{
+			const int padding = 2;
+			std::vector<mmw::AtlasRegion> regions{ { 3, 2 }, { 4, 4 } };
+			std::vector<mmw::AtlasPage> pages = mmw::AtlasPacker(64, padding).pack(regions);
+			const mmw::AtlasPage& page = pages[0];
+			const mmw::AtlasRegion& region = regions[0];
+
+			std::vector<uint8_t> image(region.width * region.height * 4);
+			for (size_t i = 0; i < image.size(); ++i)
+				image[i] = (uint8_t)(i + 1);
+
+			std::vector<uint8_t> pixels((size_t)page.width * page.height * 4, 0);
+			mmw::blitAtlasRegion(pixels, page, region, image.data(), padding);
+
+			for (int y = -padding; y < region.height + padding; ++y)
+			{
+				for (int x = -padding; x < region.width + padding; ++x)
+				{
+					int sourceX = std::clamp(x, 0, region.width - 1);
+					int sourceY = std::clamp(y, 0, region.height - 1);
+					for (int c = 0; c < 4; ++c)
+					{
+						uint8_t expected = image[(sourceY * region.width + sourceX) * 4 + c];
+						uint8_t actual = pixels[((region.y + y) * page.width + region.x + x) * 4 + c];
+						Assert::AreEqual(expected, actual);
+					}
+				}
+			}
+
+			// nothing is written outside the padded area
+			int written = std::count_if(pixels.begin(), pixels.end(), [](uint8_t p) { return p != 0; });
+			Assert::AreEqual((region.width + padding * 2) * (region.height + padding * 2) * 4, written);
+		}
+	};
 }